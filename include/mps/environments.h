@@ -0,0 +1,82 @@
+// -*- mode: c++; fill-column: 80; c-basic-offset: 2; indent-tabs-mode: nil -*-
+/*
+    Copyright (c) 2010 Juan Jose Garcia Ripoll
+
+    Tensor is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published
+    by the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Library General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+
+#ifndef MPS_ENVIRONMENTS_H
+#define MPS_ENVIRONMENTS_H
+
+#include <cstdio>
+#include <vector>
+#include <tensor/tensor.h>
+
+namespace mps {
+
+  using namespace tensor;
+
+  /** Storage for the environments of a QuadraticForm or a LinearForm.
+      There is one slot per bond of the lattice, each of them holding a
+      vector of tensors. When the flag MPS_ENVIRONMENT_WINDOW is zero, all
+      slots are kept in memory. Otherwise only the slots within that many
+      bonds of the sweep front remain in memory; the others are written to
+      an anonymous scratch file, created in $TMPDIR, and read back before
+      the sweep reaches them.
+  */
+  template<class Tensor>
+  class EnvironmentStore {
+  public:
+    typedef std::vector<Tensor> slot_t;
+
+    /** Create the store with the given initial content of the slots. */
+    explicit EnvironmentStore(const std::vector<slot_t> &slots);
+    ~EnvironmentStore();
+
+    /** Number of slots. */
+    index size() const { return slot_.size(); }
+    /** Access a slot, reading it from the scratch file if needed. */
+    const slot_t &operator[](index k) const;
+    /** Access a slot to change it. The slot is read from the scratch file
+        if needed, and written back when it leaves memory. */
+    slot_t &modify(index k);
+    /** Inform that the sweep is at bond 'k' moving in direction 'sense'.
+        Slots that fall outside the window are moved to the scratch file
+        and those ahead of the front are read in advance. */
+    void move_to(index k, int sense);
+    /** Number of slots that are currently in memory. */
+    index resident_slots() const;
+
+  private:
+    mutable std::vector<slot_t> slot_;
+    mutable std::vector<char> in_memory_, modified_;
+    std::vector<long> offset_, capacity_;
+    index window_;
+    mutable std::FILE *file_;
+
+    void fetch(index k) const;
+    void write(index k);
+
+    EnvironmentStore(const EnvironmentStore &);
+    EnvironmentStore &operator=(const EnvironmentStore &);
+  };
+
+  extern template class EnvironmentStore<RTensor>;
+  extern template class EnvironmentStore<CTensor>;
+
+} // namespace mps
+
+#endif /* !MPS_ENVIRONMENTS_H */
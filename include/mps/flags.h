@@ -64,6 +64,16 @@ namespace mps {
   extern const unsigned int MPS_SOLVE_ALGORITHM;
   /**Flag key indicating what relative error is acceptable when inverting.*/
   extern const unsigned int MPS_SOLVE_TOLERANCE;
+  /**Flag key for preconditioning solve_shifted() with the diagonal of the
+     effective operator.*/
+  extern const unsigned int MPS_SOLVE_PRECONDITION;
+
+  /**Flag key for the tolerance when comparing U(1) charges.*/
+  extern const unsigned int MPS_CHARGE_TOLERANCE;
+
+  /**Flag key for the bonds around the sweep front whose environments are
+     kept in memory (0 keeps all of them).*/
+  extern const unsigned int MPS_ENVIRONMENT_WINDOW;
 
   /**iTEBD expectation values assuming canonical form.*/
   extern const unsigned int MPS_ITEBD_CANONICAL_EXPECTED;
@@ -22,6 +22,7 @@
 
 #include <vector>
 #include <mps/mps.h>
+#include <mps/environments.h>
 
 namespace mps {
 
@@ -74,12 +75,12 @@ namespace mps {
     const tensor_t weight_;
     const std::vector<MPS> bra_;
     index size_, current_site_;
-    matrix_database_t matrix_;
+    EnvironmentStore<tensor_t> matrix_;
 
-    tensor_t &left_matrix(index i, index site) { return matrix_[i][site]; }
-    tensor_t &right_matrix(index i, index site) { return matrix_[i][site+1]; }
-    const tensor_t &left_matrix(index i, index site) const { return matrix_[i][site]; }
-    const tensor_t &right_matrix(index i, index site) const { return matrix_[i][site+1]; }
+    tensor_t &modify_left_matrix(index i, index site) { return matrix_.modify(site)[i]; }
+    tensor_t &modify_right_matrix(index i, index site) { return matrix_.modify(site+1)[i]; }
+    const tensor_t &left_matrix(index i, index site) const { return matrix_[site][i]; }
+    const tensor_t &right_matrix(index i, index site) const { return matrix_[site+1][i]; }
 
     void initialize_matrices(int start, const MPS &ket);
     matrix_database_t make_matrix_array();
@@ -20,6 +20,8 @@
 #ifndef MPS_MINIMIZER_H
 #define MPS_MINIMIZER_H
 
+#include <string>
+#include <vector>
 #include <mps/mps.h>
 #include <mps/mpo.h>
 
@@ -30,8 +32,14 @@ namespace mps {
     MinimizerOptions() :
       sweeps(32), display(false), debug(false), tolerance(1e-10),
       svd_tolerance(1e-11), allow_E_growth(1), Dmax(0),
-      do_eigenstate_fidelity(1), simp_tol(1e-13),
-      simp_sweeps(20), simp_Dmax(100)
+      do_eigenstate_fidelity(1), exact_eigenstate_fidelity(false),
+      simp_tol(1e-13),
+      simp_sweeps(20), simp_Dmax(100), eigs_tolerance(1e-10),
+      eigs_maxiter(200), subspace_expansion(false), expansion_alpha(1e-4),
+      expansion_alpha_min(1e-12),
+      checkpoint_file("minimizer_checkpoint.dat"), checkpoint_every(0),
+      resume_from_checkpoint(false),
+      target_discarded_weight(0), Dmax_limit(0)
     {}
 
     index sweeps;
@@ -42,10 +50,44 @@ namespace mps {
     int allow_E_growth;
     index Dmax;
     bool do_eigenstate_fidelity;
+    // Compute <psi|H^2|psi> exactly instead of simplifying H|psi>
+    bool exact_eigenstate_fidelity;
     // Simplification options at computing the eigenstate fidelity
     double simp_tol;
     index simp_sweeps;
     index simp_Dmax;
+    // Local eigenvalue solver: the tolerance in the residual starts loose
+    // and is reduced after each sweep, down to eigs_tolerance.
+    double eigs_tolerance;
+    index eigs_maxiter;
+    // With Dmax != 0, optimize one site at a time and grow the bonds by
+    // subspace expansion, instead of using two-site updates. After each
+    // sweep, the weight of the expansion is reduced to the change of the
+    // energy in that sweep, but not below expansion_alpha_min.
+    bool subspace_expansion;
+    double expansion_alpha;
+    double expansion_alpha_min;
+    // Save the state and the environments to checkpoint_file every
+    // checkpoint_every sweeps (0 disables it). The file is removed when the
+    // minimization stops before running out of sweeps. Only if
+    // resume_from_checkpoint is set and the file exists, minimize() ignores
+    // the state it is given and resumes from the file. The file records the
+    // size, the physical and MPO bond dimensions and whether there is a
+    // constraint, and the program aborts if they differ from the problem.
+    std::string checkpoint_file;
+    index checkpoint_every;
+    bool resume_from_checkpoint;
+    // Values of Dmax, svd_tolerance and of the eigensolver tolerance for
+    // each sweep. The last value of a schedule applies to the remaining
+    // sweeps, and empty schedules leave the options above unchanged.
+    std::vector<index> Dmax_schedule;
+    std::vector<double> svd_tolerance_schedule;
+    std::vector<double> eigs_tolerance_schedule;
+    // If nonzero, Dmax is increased by half after every sweep in which the
+    // largest discarded weight exceeds this value, up to Dmax_limit (when
+    // nonzero).
+    double target_discarded_weight;
+    index Dmax_limit;
   };
 
   double minimize(const RMPO &H, RMPS *psi, const MinimizerOptions &opt,
@@ -76,6 +118,21 @@ namespace mps {
   double minimize(const RMPO &H, RMPS *psi);
   double minimize(const CMPO &H, CMPS *psi);
 
+  // Minimize the sum of the MPOs in 'H' times 'weights' without merging
+  // them: each term keeps its own environments (see QuadraticForm) and
+  // the cost is the sum of the costs of the terms.
+  double minimize(const RTensor &weights, const std::vector<RMPO> &H,
+                  RMPS *psi, const MinimizerOptions &opt,
+                  double &eig_fidelity, double &simp_err);
+  double minimize(const CTensor &weights, const std::vector<CMPO> &H,
+                  CMPS *psi, const MinimizerOptions &opt,
+                  double &eig_fidelity, double &simp_err);
+
+  double minimize(const RTensor &weights, const std::vector<RMPO> &H,
+                  RMPS *psi, const MinimizerOptions &opt);
+  double minimize(const CTensor &weights, const std::vector<CMPO> &H,
+                  CMPS *psi, const MinimizerOptions &opt);
+
 } // namespace dmrg
 
 #endif /* !MPS_MINIMIZER_H */
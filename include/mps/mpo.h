@@ -49,10 +49,45 @@ namespace mps {
 
   void add_product_term(CMPO *mpdo, const std::vector<CTensor> &Hi);
 
+  /** Add the interaction \sum_{i<j} J(j-i) Hi(i) Hj(j), with J(r) = J[r-1]
+      for r = 1...L-1. The coupling is fitted with a sum of at most K (0 = no
+      limit) exponentials, truncating the singular values of its Hankel
+      matrix with 'tol' (see where_to_truncate()). The MPO bond dimension
+      grows by the number of exponentials, independently of the size. The
+      function returns the largest error of the fitted couplings. */
+  double add_long_range_interaction(RMPO *mpo, const RTensor &Hi,
+                                    const RTensor &Hj, const RTensor &J,
+                                    double tol = 1e-12, index K = 0);
+
+  /** Add the interaction \sum_{i<j} J(j-i) Hi(i) Hj(j). See
+      add_long_range_interaction(RMPO*,...). */
+  double add_long_range_interaction(CMPO *mpo, const CTensor &Hi,
+                                    const CTensor &Hj, const RTensor &J,
+                                    double tol = 1e-12, index K = 0);
+
   const RMPS apply(const RMPO &mpdo, const RMPS &state);
 
   const CMPS apply(const CMPO &mpdo, const CMPS &state);
 
+  /** Apply the MPO onto a state vector, in the order of mps_to_vector(),
+      without building the matrix of the MPO. The memory grows as the size
+      of the vector times the bond dimension of the MPO, which allows exact
+      references for 20 to 28 spins. */
+  const RTensor apply(const RMPO &mpo, const RTensor &v);
+
+  /** Apply the MPO onto a state vector. See apply(const RMPO&, const RTensor&). */
+  const CTensor apply(const CMPO &mpo, const CTensor &v);
+
+  /** Lowest eigenvalue of a Hermitian MPO, computed with the Lanczos
+      method of ARPACK on top of apply(const RMPO&, const RTensor&). On
+      output '*v', if not NULL, holds the eigenvector, in the order of
+      mps_to_vector(). If on input it has the right size, it is used as
+      the starting vector. */
+  double ground_state(const RMPO &H, RTensor *v = 0);
+
+  /** Lowest eigenvalue of a Hermitian MPO. See ground_state(const RMPO&, RTensor*). */
+  double ground_state(const CMPO &H, CTensor *v = 0);
+
   double expected(const RMPS &bra, const RMPO &op, const RMPS &ket);
 
   double expected(const RMPS &bra, const RMPO &op);
@@ -69,6 +104,46 @@ namespace mps {
 
   const RMPO mmult(const RMPO &A, const RMPO &B);
 
+  /** Product of two MPOs, A*B, compressed with compress(). Channels 0 and
+      1 of the result are those where neither or both operators have been
+      applied, so that the product of two Hamiltonians keeps the layout of
+      add_local_term(). */
+  const RMPO mmult_compressed(const RMPO &A, const RMPO &B, double tol = 0);
+
+  /** Product of two MPOs, compressed. See mmult_compressed(const RMPO &,...). */
+  const CMPO mmult_compressed(const CMPO &A, const CMPO &B, double tol = 0);
+
+  /** Sum of two MPOs with the layout of add_local_term(), compressed with
+      compress(). */
+  const RMPO add(const RMPO &A, const RMPO &B, double tol = 0);
+
+  /** Sum of two MPOs, compressed. See add(const RMPO &,...). */
+  const CMPO add(const CMPO &A, const CMPO &B, double tol = 0);
+
+  /** Reduce the bond dimension of an MPO. Channels that are opened or closed
+      with parallel operators are merged exactly. If 'tol' is positive, the
+      remaining inner channels are also truncated with SVDs, sweeping in both
+      directions, using 'tol' as in where_to_truncate(). Channels 0 and 1 are
+      preserved, but the SVD step makes the rest of the tensors dense.
+      Since the inner block is not orthogonalized against channels 0 and 1,
+      the singular values are not those of a canonical form, and a positive
+      'tol' is a heuristic with no bound on the error of the MPO. With
+      'tol' = 0 the compression is exact. */
+  const RMPO compress(const RMPO &mpo, double tol = 0);
+
+  /** Reduce the bond dimension of an MPO. See compress(const RMPO&,double). */
+  const CMPO compress(const CMPO &mpo, double tol = 0);
+
+  /** Approximate exp(tau*H) by an MPO with one channel less than H, using
+      the W^I (method = 1) or W^II (method = 2) constructions of Zaletel et
+      al., PRB 91, 165112 (2015). H must have the layout of add_local_term(),
+      but may contain interactions of any range. The error per step is
+      O(tau^2), and both are exact when H only has local terms. */
+  const RMPO exponential_mpo(const RMPO &H, double tau, int method = 2);
+
+  /** Approximate exp(tau*H) by an MPO. See exponential_mpo(const RMPO&,...). */
+  const CMPO exponential_mpo(const CMPO &H, cdouble tau, int method = 2);
+
   /** Return the matrix that represents the MPO acting on the full Hilbert
       space. Use with care with only small tensors, as this may exhaust the
       memory of your computer. */
@@ -78,6 +153,16 @@ namespace mps {
       space. Use with care with only small tensors, as this may exhaust the
       memory of your computer. */
   const CTensor mpo_to_matrix(const CMPO &A);
+
+  /** Return the sparse matrix that represents the MPO acting on the full
+      Hilbert space, with the same ordering as mpo_to_matrix(). The nonzero
+      elements are enumerated with the MPO automaton, in parallel over
+      chunks of rows. */
+  const RSparse mpo_to_sparse(const RMPO &A);
+
+  /** Return the sparse matrix that represents the MPO acting on the full
+      Hilbert space. See mpo_to_sparse(const RMPO &). */
+  const CSparse mpo_to_sparse(const CMPO &A);
 }
 
 #endif /* !MPO_MPO_H */
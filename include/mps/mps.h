@@ -182,15 +182,41 @@ namespace mps {
 
   /** Update an MPS with a tensor that spans two sites, (site,site+1). Dmax is
    * the maximum bond dimension that is used. Actually, tol and Dmax are the
-   * arguments to where_to_truncate. */
+   * arguments to where_to_truncate. Returns the weight of the discarded
+   * singular values, relative to the norm of Pij. */
+  double set_canonical_2_sites(RMPS &P, const RTensor &Pij, index site, int sense,
+                               index Dmax = 0, double tol = -1, bool canonicalize_both = true);
+
+  /** Update an MPS with a tensor that spans two sites, (site,site+1), and
+   * conserves a U(1) charge. The vectors 'row_charges' and 'column_charges'
+   * label the combined indices (a,i) and (j,b) of Pij with the charge that
+   * the bond (site,site+1) would carry. Only the blocks with equal labels are
+   * decomposed and truncated, and the charges of the new bond are returned
+   * in 'bond_charges'. */
   void set_canonical_2_sites(RMPS &P, const RTensor &Pij, index site, int sense,
-                             index Dmax = 0, double tol = -1, bool canonicalize_both = true);
+                             const RTensor &row_charges,
+                             const RTensor &column_charges,
+                             RTensor *bond_charges, index Dmax = 0,
+                             double tol = -1);
 
   /** Update an MPS with a tensor that spans two sites, (site,site+1). Dmax is
    * the maximum bond dimension that is used. Actually, tol and Dmax are the
-   * arguments to where_to_truncate. */
+   * arguments to where_to_truncate. Returns the weight of the discarded
+   * singular values, relative to the norm of Pij. */
+  double set_canonical_2_sites(CMPS &P, const CTensor &Pij, index site, int sense,
+                               index Dmax = 0, double tol = -1, bool canonicalize_both = true);
+
+  /** Update an MPS with a tensor that spans two sites, (site,site+1), and
+   * conserves a U(1) charge. The vectors 'row_charges' and 'column_charges'
+   * label the combined indices (a,i) and (j,b) of Pij with the charge that
+   * the bond (site,site+1) would carry. Only the blocks with equal labels are
+   * decomposed and truncated, and the charges of the new bond are returned
+   * in 'bond_charges'. */
   void set_canonical_2_sites(CMPS &P, const CTensor &Pij, index site, int sense,
-                             index Dmax = 0, double tol = -1, bool canonicalize_both = true);
+                             const RTensor &row_charges,
+                             const RTensor &column_charges,
+                             RTensor *bond_charges, index Dmax = 0,
+                             double tol = -1);
 
   /* Return a single-site density matrix out of an MPS. */
   const RTensor density_matrix(const RMPS &psi, index site);
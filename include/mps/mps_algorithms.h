@@ -79,12 +79,48 @@ namespace mps {
                       int *sense, index sweeps, bool normalize,
                       index Dmax = 0, double tol = -1, double *norm = 0);
 
+  /** Approximate H|psi> by a state with bond dimension at most Dmax, with
+      'tol' the truncation tolerance (see where_to_truncate()). The product
+      is fitted with two-site sweeps over <phi|H|psi>, without building the
+      exact product, whose bond dimension is that of H times that of psi.
+      Each sweep goes right and left, so that the output is in canonical
+      form with respect to site 0. 'err', if given, receives the relative
+      truncation error of the last sweep, the square root of the summed
+      weights discarded by set_canonical_2_sites(). */
+  const RMPS apply_and_compress(const RMPO &H, const RMPS &psi, index Dmax,
+                                double tol = -1, index sweeps = 4,
+                                double *err = 0);
+
+  /** Approximate H|psi> by a state with bond dimension at most Dmax. See
+      apply_and_compress(const RMPO &, const RMPS &, ...). */
+  const CMPS apply_and_compress(const CMPO &H, const CMPS &psi, index Dmax,
+                                double tol = -1, index sweeps = 4,
+                                double *err = 0);
+
   double solve(const RMPO &H, RMPS *ptrP, const RMPS &Q, int *sense, index sweeps,
                bool normalize = false, index Dmax = 0, double tol = -1);
 
   double solve(const CMPO &H, CMPS *ptrP, const CMPS &Q, int *sense, index sweeps,
                bool normalize = false, index Dmax = 0, double tol = -1);
 
+  /** Solve (H - shift) P = Q, for a Hermitian H, with two-site sweeps
+      that work on the effective H, instead of minimizing |(H-shift)P-Q|^2
+      with H^+ H as solve() does. The local problems are solved with MINRES
+      (see FLAGS MPS_SOLVE_PRECONDITION). 'P' is the initial guess, or an
+      empty MPS to start from 'Q', and 'tol' is both the tolerance of the
+      local solver and the truncation tolerance, by default
+      MPS_SOLVE_TOLERANCE. The sweeps stop when the relative change of
+      <Q|P> is below 'tol'. Returns the largest residual of the local
+      problems in the last sweep, relative to |Q|. */
+  double solve_shifted(const RMPO &H, double shift, RMPS *ptrP, const RMPS &Q,
+                       index sweeps, index Dmax = 0, double tol = -1);
+
+  /** Solve (H - shift) P = Q. See solve_shifted(const RMPO &, ...). With
+      shift = w + i eta the local problems are solved with GMRES, and -<Q|P>
+      is the Green's function <Q|(w + i eta - H)^{-1}|Q>. */
+  double solve_shifted(const CMPO &H, cdouble shift, CMPS *ptrP, const CMPS &Q,
+                       index sweeps, index Dmax = 0, double tol = -1);
+
   double eigenstate_fidelity(const RMPO &H, const RMPS &psi,
                              double &simp_err, double simp_tol,
                              tensor::index simp_sweeps, tensor::index simp_Dmax,
@@ -95,6 +131,14 @@ namespace mps {
                              tensor::index simp_sweeps, tensor::index simp_Dmax,
                              double *ptrE = 0);
 
+  /** Eigenstate fidelity with <psi|H^2|psi> computed exactly, without
+      simplifying H|psi>. */
+  double eigenstate_fidelity(const RMPO &H, const RMPS &psi, double *ptrE = 0);
+
+  /** Eigenstate fidelity with <psi|H^2|psi> computed exactly, without
+      simplifying H|psi>. */
+  double eigenstate_fidelity(const CMPO &H, const CMPS &psi, double *ptrE = 0);
+
 } // namespace mps
 
 #endif // !MPS_MPS_ALGORITHM_H
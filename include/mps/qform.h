@@ -21,9 +21,11 @@
 #define MPS_QFORM_H
 
 #include <vector>
-#include <list>
-#include <mps/mpo.h>
+#include <string>
+#include <tensor/sdf.h>
+#include <mps/sparse_mpo.h>
 #include <mps/hamiltonian.h>
+#include <mps/environments.h>
 
 namespace mps {
 
@@ -46,6 +48,21 @@ namespace mps {
 	assumes that we are inspecting site 'start', which may be at the
 	beginning or the end of the chain.*/
     QuadraticForm(const mpo_t &mpo, const mps_t &bra, const mps_t &ket, int start = 0);
+    /** Initialize with the sum of the MPOs times the given weights. The
+	terms keep separate environments and the matrix-vector products are
+	the sum of those of each term, instead of using an MPO with the
+	merged bond dimension.*/
+    QuadraticForm(const elt_t &weights, const std::vector<mpo_t> &mpos,
+		  const mps_t &bra, const mps_t &ket, int start = 0);
+    /** Initialize with the given MPO, reading the site and the environments
+	from a file written by dump(). */
+    QuadraticForm(const mpo_t &mpo, sdf::InDataFile &file, const std::string &name);
+    /** Initialize with a weighted sum of MPOs, reading the site and the
+	environments from a file written by dump(). */
+    QuadraticForm(const elt_t &weights, const std::vector<mpo_t> &mpos,
+		  sdf::InDataFile &file, const std::string &name);
+    /** Write the site and the environments, labelled by 'name'. */
+    void dump(sdf::OutDataFile &file, const std::string &name);
     /** Update the form changing the tensors of the bra and ket states. The
 	function updates the $\psi$ and $\phi$ states in $\langle\psi|O|\phi\rangle$
 	changing the tensor of those states at the site here(), and moving to
@@ -64,6 +81,8 @@ namespace mps {
     index size() const { return size_; }
     /** Last site in the lattice. */
     index last_site() const { return size_-1; }
+    /** Number of environments that are currently kept in memory. */
+    index resident_environments() const { return matrix_.resident_slots(); }
 
     /** Matrix representation of the quadratic form with respect to site here().*/
     const elt_t single_site_matrix() const;
@@ -74,59 +93,63 @@ namespace mps {
     const elt_t apply_one_site_matrix(const elt_t &P) const;
     /** Apply the two_site_matrix() onto a tensor representing two sites. */
     const elt_t apply_two_site_matrix(const elt_t &P12, int sense = +1) const;
+    /** Apply the two_site_matrix() onto a tensor that conserves a U(1)
+	charge. 'qleft' and 'qright' are the charges of the outer bonds of
+	P12, and the product only uses the blocks between charge sectors of
+	the environments and of P12 that are not zero. */
+    const elt_t apply_two_site_matrix(const elt_t &P12, int sense,
+                                      const RTensor &qleft,
+                                      const RTensor &qright) const;
     /** Efficiently take the diagonal part of the single_site_matrix(). */
     const elt_t take_single_site_matrix_diag() const;
     /** Efficiently take the diagonal part of the two_site_matrix(). */
     const elt_t take_two_site_matrix_diag(int sense = +1) const;
+    /** Subspace expansion term for a single-site tensor P(a1,i,a2). This is
+	the quadratic form contracted with P on the left (sense > 0) or on
+	the right (sense < 0) of site here(), which is returned with the MPO
+	index merged into that bond, as a tensor (a1,i,a2*W) or (a1*W,i,a2).*/
+    const elt_t expansion_term(const elt_t &P, int sense) const;
 
   private:
 
-    struct Pair {
-      int left_ndx, right_ndx; // inner dimensions in the MPO
-      elt_t op; // operator
-
-      Pair(int i, int j, const elt_t &tensor) :
-	left_ndx(i),
-	right_ndx(j),
-	op(reshape(tensor(range(i), range(),range(), range(j)),
-		   tensor.dimension(1), tensor.dimension(2)))
-      {}
-
-      bool is_empty() const { return norm2(op) == 0; }
-    };
-
     typedef typename std::vector<elt_t> matrix_array_t;
     typedef typename std::vector<matrix_array_t> matrix_database_t;
-    typedef typename std::list<Pair> pair_list_t;
-    typedef typename std::vector<pair_list_t> pair_tree_t;
-    typedef typename pair_list_t::const_iterator pair_iterator_t;
+    typedef std::vector<index> index_array_t;
+
+    typedef typename SparseMPO<elt_t>::Site site_t;
 
     int current_site_, size_;
-    matrix_database_t matrix_;
-    pair_tree_t pairs_;
+    SparseMPO<elt_t> pairs_;
+    EnvironmentStore<elt_t> matrix_;
 
-    elt_t &left_matrix(index site, int n) {
-      return matrix_[site][n];
-    }
-    elt_t &right_matrix(index site, int n) {
-      return matrix_[site+1][n];
-    }
     const elt_t &left_matrix(index site, int n) const {
       return matrix_[site][n];
     }
     const elt_t &right_matrix(index site, int n) const {
       return matrix_[site+1][n];
     }
-    matrix_array_t &left_matrices(index site) {
+    matrix_array_t &modify_left_matrices(index site) {
+      return matrix_.modify(site);
+    }
+    matrix_array_t &modify_right_matrices(index site) {
+      return matrix_.modify(site+1);
+    }
+    const matrix_array_t &left_matrices(index site) const {
       return matrix_[site];
     }
-    matrix_array_t &right_matrices(index site) {
+    const matrix_array_t &right_matrices(index site) const {
       return matrix_[site+1];
     }
     void dump_matrices();
-
-    static matrix_database_t make_matrix_database(const mpo_t &mpo);
-    static pair_tree_t make_pairs(const mpo_t &mpo);
+    void initialize(const mps_t &bra, const mps_t &ket, int start);
+    void load_site(sdf::InDataFile &file, const std::string &name);
+
+    static SparseMPO<elt_t> make_sum(const elt_t &weights,
+                                     const std::vector<mpo_t> &mpos);
+    static matrix_database_t make_matrix_database(const SparseMPO<elt_t> &mpo);
+    static matrix_database_t load_matrix_database(const SparseMPO<elt_t> &mpo,
+                                                  sdf::InDataFile &file,
+                                                  const std::string &name);
   };
 
   extern template class QuadraticForm<RMPO>;
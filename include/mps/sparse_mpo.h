@@ -0,0 +1,108 @@
+// -*- mode: c++; fill-column: 80; c-basic-offset: 2; indent-tabs-mode: nil -*-
+/*
+    Copyright (c) 2010 Juan Jose Garcia Ripoll
+
+    Tensor is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published
+    by the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Library General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#ifndef MPS_SPARSE_MPO_H
+#define MPS_SPARSE_MPO_H
+
+#include <vector>
+#include <mps/mpo.h>
+
+namespace mps {
+
+  using namespace tensor;
+
+  /** MPO stored as a sparse matrix of operators. On every site, the tensor
+      O(a,i,j,b) is replaced by its nonzero (a,b) blocks, the operators
+      O(i,j), and those blocks that are the identity are flagged, so that
+      applying them reduces to a copy. This is the representation used
+      by apply(), mmult(), expected() and QuadraticForm.
+  */
+  template<class Tensor>
+  class SparseMPO {
+  public:
+    typedef Tensor elt_t;
+    typedef std::vector<index> index_array_t;
+
+    /** Nonzero blocks of one site. The operators are sorted by the left
+        index 'a', so that those leaving 'a' are found at the positions
+        [left_start[a],left_start[a+1]). The array
+        by_right[right_start[b]...right_start[b+1]-1] lists, in increasing
+        order, the positions of the operators arriving at 'b'. */
+    struct Site {
+      std::vector<Tensor> op;
+      std::vector<bool> identity;
+      index_array_t left_ndx, right_ndx;
+      index_array_t left_start, right_start, by_right;
+      /** Dimensions of the operators, O(i,j) with i < d1, j < d2. */
+      index d1, d2;
+
+      index size() const { return op.size(); }
+      index left_dimension() const { return left_start.size() - 1; }
+      index right_dimension() const { return right_start.size() - 1; }
+    };
+
+    SparseMPO() {}
+    /** Create an MPO with 'size' sites, to be filled with set_site(). */
+    explicit SparseMPO(index size) : sites_(size) {}
+    /** Extract the nonzero blocks of a dense MPO. */
+    explicit SparseMPO(const MP<Tensor> &mpo);
+    /** Weighted sum of MPOs that keeps their channels apart. The inner
+        bonds are the direct sums of those of the terms, so that working
+        with the sum costs the same as working with each term. */
+    SparseMPO(const std::vector<SparseMPO> &terms, const Tensor &weights);
+
+    /** Number of sites. */
+    index size() const { return sites_.size(); }
+    /** Blocks of the k-th site. */
+    const Site &operator[](index k) const { return sites_[k]; }
+    /** Replace the k-th site with the given blocks, which may come in any
+        order, between 'a' left and 'b' right channels. */
+    void set_site(index k, index a, index b, index d1, index d2,
+                  const std::vector<Tensor> &op,
+                  const std::vector<bool> &identity,
+                  const index_array_t &left_ndx,
+                  const index_array_t &right_ndx);
+    /** Dense tensor O(a,i,j,b) of the k-th site. */
+    const Tensor dense(index k) const;
+
+  private:
+    std::vector<Site> sites_;
+  };
+
+  extern template class SparseMPO<RTensor>;
+  typedef SparseMPO<RTensor> RSparseMPO;
+
+  extern template class SparseMPO<CTensor>;
+  typedef SparseMPO<CTensor> CSparseMPO;
+
+  const RMPS apply(const RSparseMPO &mpo, const RMPS &state);
+
+  const CMPS apply(const CSparseMPO &mpo, const CMPS &state);
+
+  double expected(const RMPS &bra, const RSparseMPO &op, const RMPS &ket);
+
+  cdouble expected(const CMPS &bra, const CSparseMPO &op, const CMPS &ket);
+
+  const RSparseMPO mmult(const RSparseMPO &A, const RSparseMPO &B);
+
+  const CSparseMPO mmult(const CSparseMPO &A, const CSparseMPO &B);
+
+} // namespace mps
+
+#endif /* !MPS_SPARSE_MPO_H */
@@ -73,6 +73,12 @@ namespace mps {
 
     virtual ~TrotterSolver();
 
+    /**Advance the state by 'nsteps' time steps. Solvers whose steps begin
+       and end with the same half layer merge those layers between
+       consecutive steps, so that the state is only split into full steps
+       at the end. The default just calls one_step() repeatedly.*/
+    virtual double evolve(CMPS *P, index nsteps, index Dmax);
+
   protected:
     /*Unitary arising from a Trotter decomposition.
 
@@ -105,6 +111,13 @@ namespace mps {
 				  index k1, index k2, int dk,
 				  double tolerance, index max_a2) const;
     };
+
+    /*Apply one layer following the truncation 'strategy', with the
+      'tolerance' and 'Dmax' that one_step() uses for that layer.
+      'group_end' marks the layers where TRUNCATE_GROUPS truncates the
+      state.*/
+    double apply_layer(const Unitary &U, CMPS *P, int *sense, double tolerance,
+                       index Dmax, bool group_end, bool normalize_output) const;
   };
 
   /**Trotter method with only two passes. This solver uses the second order Trotter approximation:
@@ -131,19 +144,23 @@ namespace mps {
      exp(-iH_{even} \Delta t/2)\f]
   */
   class Trotter3Solver : public TrotterSolver {
-    Unitary U1, U2;
+    Unitary U1, U2, U3;
     int sense;
   public:
     /**Create a solver for the given nearest neighbor Hamiltonian and time step.*/
     Trotter3Solver(const Hamiltonian &H, cdouble dt);
 
     virtual double one_step(CMPS *P, index Dmax);
+
+    /**Advance 'nsteps' time steps, merging the final and initial
+       \f$exp(-iH_{even} \Delta t/2)\f$ of consecutive steps.*/
+    virtual double evolve(CMPS *P, index nsteps, index Dmax);
   };
 
   /**Forest-Ruth method. This method uses a fourth order Forest-Ruth decomposition
      (see http://xxx.arxiv.org/cond-mat/0610210)*/
   class ForestRuthSolver : public TrotterSolver {
-    Unitary U1, U2, U3, U4;
+    Unitary U1, U2, U3, U4, U1x2;
     int sense;
   public:
     int sweeps;
@@ -152,6 +169,10 @@ namespace mps {
     ForestRuthSolver(const Hamiltonian &H, cdouble dt);
     
     virtual double one_step(CMPS *P, index Dmax);
+
+    /**Advance 'nsteps' time steps, merging the last and first layers of
+       consecutive steps.*/
+    virtual double evolve(CMPS *P, index nsteps, index Dmax);
   };
 
   /**Time evolution with the Arnoldi method.
@@ -174,6 +195,113 @@ namespace mps {
     const CMPO H_;
     const int max_states_;
     const double tolerance_;
+
+    const CMPS apply_krylov(const CMPS &psi, index Dmax) const;
+  };
+
+  /**Time evolution with the MPO approximation of exp(-iH dt) given by
+     exponential_mpo(). It works for interactions of any range, and each step
+     costs one application of that MPO, fitted to the bond dimension Dmax.
+  */
+  class MPOSolver : public TimeSolver {
+  public:
+    /**Number of sweeps of apply_and_compress().*/
+    int sweeps;
+    /**Normalize the state after each step.*/
+    bool normalize;
+    /**Truncation tolerance, as in where_to_truncate().*/
+    double tolerance;
+
+    /**Create Solver with fixed time step, using W^I (method = 1) or W^II
+       (method = 2).*/
+    MPOSolver(const Hamiltonian &H, cdouble dt, int method = 2);
+
+    /**Create Solver with fixed time step, using W^I (method = 1) or W^II
+       (method = 2).*/
+    MPOSolver(const CMPO &H, cdouble dt, int method = 2);
+
+    /**Compute next time step. Given the state \f$\psi(0)\f$ represented
+       by P, estimate the state at \f$\psi(\Delta t)\f$ within the space
+       of MPS with dimension <= Dmax. P contains the output.*/
+    virtual double one_step(CMPS *P, index Dmax);
+
+  private:
+    const CMPO U_;
+  };
+
+  /**Second order TEBD on the Vidal form of a finite MPS. The state is kept
+     as right-canonical tensors \f$B_k = \Gamma_k\Lambda_k\f$ together with
+     the Schmidt vectors \f$\Lambda\f$ of every bond, which is Hastings'
+     formulation of the algorithm and never inverts a \f$\Lambda\f$. The
+     gates of a layer act on disjoint bonds and are applied in parallel.
+  */
+  class TEBDSolver : public TimeSolver {
+  public:
+    /**Truncation tolerance, as in where_to_truncate().*/
+    double tolerance;
+
+    /**Create a solver for the given nearest neighbor Hamiltonian and time step.*/
+    TEBDSolver(const Hamiltonian &H, cdouble dt);
+
+    /**Compute next time step. Given the state \f$\psi(0)\f$ represented
+       by P, estimate the state at \f$\psi(\Delta t)\f$ within the space
+       of MPS with dimension <= Dmax. P contains the output.*/
+    virtual double one_step(CMPS *P, index Dmax);
+
+  private:
+    std::vector<CTensor> U_;
+    std::vector<CTensor> B_;
+    std::vector<RTensor> lambda_;
+    CMPS last_;
+
+    void set_state(const CMPS &P);
+    double apply_layer(int parity, index Dmax);
+    double apply_gate(index k, index Dmax);
+  };
+
+  template<class MPO> class QuadraticForm;
+
+  /**Time evolution with the time-dependent variational principle. The
+     solver performs symmetric sweeps that integrate each local tensor with
+     a Lanczos exponential of the effective Hamiltonian, either on pairs of
+     sites (which lets the bond dimension grow up to Dmax) or on single
+     sites (which keeps it fixed). The environments of the Hamiltonian are
+     kept from one step to the next, as long as the state is not modified
+     outside of the solver.
+  */
+  class TDVPSolver : public TimeSolver {
+  public:
+    /**Truncation tolerance for the two-site variant.*/
+    double tolerance;
+
+    /**Create Solver with fixed time step.*/
+    TDVPSolver(const Hamiltonian &H, cdouble dt, bool two_site = true,
+               int nvectors = 20);
+
+    /**Create Solver with fixed time step.*/
+    TDVPSolver(const CMPO &H, cdouble dt, bool two_site = true,
+               int nvectors = 20);
+
+    virtual ~TDVPSolver();
+
+    /**Compute next time step. Given the state \f$\psi(0)\f$ represented
+       by P, estimate the state at \f$\psi(\Delta t)\f$ within the space
+       of MPS with dimension <= Dmax. P contains the output.*/
+    virtual double one_step(CMPS *P, index Dmax);
+
+  private:
+    const CMPO H_;
+    const bool two_site_;
+    const int max_states_;
+    QuadraticForm<CMPO> *qform_;
+    CMPS last_;
+
+    TDVPSolver(const TDVPSolver &);
+    TDVPSolver &operator=(const TDVPSolver &);
+
+    bool same_state(const CMPS &P) const;
+    double two_site_sweep(CMPS &P, cdouble z, int sense, index Dmax);
+    void one_site_sweep(CMPS &P, cdouble z, int sense);
   };
 
 
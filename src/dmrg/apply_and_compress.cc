@@ -0,0 +1,91 @@
+// -*- mode: c++; fill-column: 80; c-basic-offset: 2; indent-tabs-mode: nil -*-
+/*
+    Copyright (c) 2010 Juan Jose Garcia Ripoll
+
+    Tensor is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published
+    by the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Library General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include <cmath>
+#include <algorithm>
+#include <mps/flags.h>
+#include <mps/mps.h>
+#include <mps/mps_algorithms.h>
+#include <mps/qform.h>
+
+namespace mps {
+
+  /*
+   * We look for the state phi with bond dimension Dmax closest to H|psi>.
+   * When all tensors of phi other than those on sites (k,k+1) are in
+   * canonical form, the distance
+   *	|H psi - phi|^2 = <psi|H^+ H|psi> + |phi|^2 - 2 re<phi|H|psi>
+   * is minimized by the two-site tensor phi(k,k+1) that results from
+   * contracting <phi|H|psi> with everything except phi(k,k+1). This is
+   * what the QuadraticForm <phi|H|psi> computes when applied onto the
+   * two-site tensor of psi, with a cost D*chi*Dmax per bond, and the
+   * residual distance is <psi|H^+ H|psi> - |phi|^2.
+   *
+   * Since <psi|H^+ H|psi> is not available without building H|psi>, we
+   * estimate the error from the singular values discarded by the bond
+   * truncations of the last sweep, in the same relative norm-2 units as
+   * simplify_obc().
+   */
+  template<class MPO, class MPS>
+  static const MPS
+  do_apply_and_compress(const MPO &H, const MPS &psi, index Dmax, double tol,
+                        index sweeps, double *err)
+  {
+    typedef typename MPS::elt_t Tensor;
+    assert(sweeps > 0);
+    double tolerance = FLAGS.get(MPS_SIMPLIFY_TOLERANCE);
+    index L = psi.size();
+    if (L == 1) {
+      // A single site needs no fit: the product is exact
+      if (err) {
+        *err = 0.0;
+      }
+      return apply(H, psi);
+    }
+
+    MPS phi = canonical_form(psi, -1);
+    QuadraticForm<MPO> qf(H, phi, psi, 0);
+    double normP2 = 0, oldnorm, change, discarded;
+    while (sweeps--) {
+      discarded = 0;
+      for (index k = 0; k+1 < L; k++) {
+        Tensor P12 = qf.apply_two_site_matrix(fold(psi[k], -1, psi[k+1], 0), +1);
+        discarded += set_canonical_2_sites(phi, P12, k, +1, Dmax, tol, false);
+        qf.propagate_right(phi[k], psi[k]);
+      }
+      for (index k = L-1; k > 0; k--) {
+        Tensor P12 = qf.apply_two_site_matrix(fold(psi[k-1], -1, psi[k], 0), -1);
+        discarded += set_canonical_2_sites(phi, P12, k, -1, Dmax, tol, false);
+        qf.propagate_left(phi[k], psi[k]);
+      }
+      // |phi|^2 grows towards |H psi|^2 as the fit improves
+      oldnorm = normP2;
+      normP2 = abs(scprod(phi[0], phi[0]));
+      change = abs(normP2 - oldnorm) / std::max(normP2, 1e-300);
+      if (change < tolerance) {
+        break;
+      }
+    }
+    if (err) {
+      *err = sqrt(discarded);
+    }
+    return phi;
+  }
+
+} // namespace mps
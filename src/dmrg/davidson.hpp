@@ -0,0 +1,119 @@
+// -*- mode: c++; fill-column: 80; c-basic-offset: 2; indent-tabs-mode: nil -*-
+/*
+    Copyright (c) 2010 Juan Jose Garcia Ripoll
+
+    Tensor is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published
+    by the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Library General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include <vector>
+#include <algorithm>
+#include <tensor/linalg.h>
+
+namespace mps {
+
+  /* Lowest eigenvalue of a Hermitian operator, computed with the Davidson
+     method and a diagonal preconditioner.
+
+     'A' is an object whose operator() applies the operator onto a vector,
+     and 'diagonal' is either empty or holds the diagonal of that operator.
+     On input '*v' is the initial guess, typically the solution found in
+     the previous sweep, and on output it is the normalized eigenvector with
+     the same dimensions. The iteration stops when the norm of the residual
+     is below 'tol' (relative to the eigenvalue, when this is larger than
+     one) or after 'maxiter' applications of 'A', which are added to
+     '*matvecs'. The function returns true in the first case. */
+  template<class Tensor, class Operator>
+  bool davidson(const Operator &A, const Tensor &diagonal, Tensor *v,
+                double *eigenvalue, double tol, index maxiter,
+                index *matvecs, index max_subspace = 24)
+  {
+    typedef typename Tensor::elt_t number;
+    index n = v->size();
+    std::vector<Tensor> V, AV;
+    Tensor x = reshape(*v, n);
+    if (norm2(x) == 0) {
+      x = Tensor::random(n);
+    }
+    Tensor u, Au;
+    double theta = 0;
+    bool converged = false;
+    for (index iter = 0; iter < maxiter; iter++) {
+      // New direction, orthonormalized (twice, for stability) with respect
+      // to the current subspace.
+      for (int pass = 0; pass < 2; pass++) {
+        for (index k = 0; k < V.size(); k++) {
+          x = x - scprod(V[k], x) * V[k];
+        }
+      }
+      double nx = norm2(x);
+      if (nx < 1e-14) {
+        break;
+      }
+      x = x / nx;
+      V.push_back(x);
+      AV.push_back(reshape(A(x), n));
+      ++*matvecs;
+
+      // Rayleigh-Ritz approximation in the subspace
+      index m = V.size();
+      Tensor H(m, m);
+      for (index i = 0; i < m; i++) {
+        for (index j = 0; j < m; j++) {
+          H.at(i,j) = scprod(V[i], AV[j]);
+        }
+      }
+      Tensor R;
+      RTensor e = linalg::eig_sym((H + adjoint(H)) / 2.0, &R);
+      index best = 0;
+      for (index i = 1; i < e.size(); i++) {
+        if (e[i] < e[best]) best = i;
+      }
+      theta = e[best];
+      u = R(0,best) * V[0];
+      Au = R(0,best) * AV[0];
+      for (index i = 1; i < m; i++) {
+        u += R(i,best) * V[i];
+        Au += R(i,best) * AV[i];
+      }
+
+      // Residual and preconditioned correction
+      Tensor r = Au - number(theta) * u;
+      if (norm2(r) <= tol * std::max(1.0, tensor::abs(theta))) {
+        converged = true;
+        break;
+      }
+      if (V.size() >= max_subspace) {
+        V.assign(1, u);
+        AV.assign(1, Au);
+      }
+      x = r;
+      if (!diagonal.is_empty()) {
+        for (index i = 0; i < n; i++) {
+          double den = real(diagonal[i]) - theta;
+          if (tensor::abs(den) < 1e-8) {
+            den = (den < 0)? -1e-8 : 1e-8;
+          }
+          x.at(i) = r[i] / den;
+        }
+      }
+    }
+    if (!u.is_empty()) {
+      *v = reshape(u / norm2(u), v->dimensions());
+    }
+    *eigenvalue = theta;
+    return converged;
+  }
+
+} // namespace mps
@@ -20,6 +20,7 @@
 #include <mps/mps.h>
 #include <mps/mps_algorithms.h>
 #include <mps/mpo.h>
+#include <mps/qform.h>
 #include <math.h>
 
 namespace mps {
@@ -30,9 +31,9 @@ namespace mps {
          
        eig_F = <psi|H|psi>/sqrt(<psi|H^2|psi>)
      
-     We will build and intermediate state: 'Hpsi' = H|psi>, which we
-     simplify according to its SVD decomposition in order to reduce
-     the size of the computation
+     We will build and intermediate state: 'Hpsi' = H|psi>, which is
+     fitted variationally with a bounded bond dimension in order to
+     reduce the size of the computation
 
      Input:
        H: Hamiltonian MPO
@@ -55,13 +56,9 @@ namespace mps {
                          tensor::index simp_sweeps, tensor::index simp_Dmax,
                          double *ptrE)
   {
-    MPS Hpsi(apply(H, psi));
-
-    // Simplify Hpsi
-    int simp_sense = -1;
-    bool normalize = 0;
-    simp_err = simplify_obc(&Hpsi, Hpsi, &simp_sense, simp_sweeps,
-                            normalize, simp_Dmax, simp_tol);
+    // Hpsi is fitted with bond dimension simp_Dmax
+    MPS Hpsi = apply_and_compress(H, psi, simp_Dmax, simp_tol, simp_sweeps,
+                                  &simp_err);
 
     // Compute <psi|H|psi> if it has not been initialized
     double E;
@@ -75,4 +72,29 @@ namespace mps {
     return eig_F;
   }
 
+  /*
+     Same quantity, but with <psi|H^2|psi> computed exactly, as the
+     quadratic form of the MPO H^+ H, without building H|psi>. The cost is
+     that of a DMRG sweep with an MPO whose bond dimension is at most the
+     square of that of H, reduced by the exact deparallelization of
+     mmult_compressed(), with no truncation error.
+   */
+
+  template<class MPS, class MPO>
+  static double
+  do_eigenstate_fidelity(const MPO &H, const MPS &psi, double *ptrE)
+  {
+    double n2 = real(scprod(psi, psi));
+    double E;
+    if (ptrE) {
+      E = *ptrE;
+    } else {
+      QuadraticForm<MPO> qH(H, psi, psi, 0);
+      E = real(scprod(psi[0], qH.apply_one_site_matrix(psi[0]))) / n2;
+    }
+    QuadraticForm<MPO> qH2(mmult_compressed(adjoint(H), H), psi, psi, 0);
+    double H2 = real(scprod(psi[0], qH2.apply_one_site_matrix(psi[0]))) / n2;
+    return tensor::abs(E)/sqrt(H2);
+  }
+
 } // namespace mps
@@ -31,5 +31,11 @@ namespace mps {
     return do_eigenstate_fidelity(H, psi, simp_err, simp_tol,
                                   simp_sweeps, simp_Dmax, ptrE);
   }
-  
+
+  double
+  eigenstate_fidelity(const CMPO &H, const CMPS &psi, double *ptrE)
+  {
+    return do_eigenstate_fidelity(H, psi, ptrE);
+  }
+
 } // namespace mps
@@ -0,0 +1,194 @@
+// -*- mode: c++; fill-column: 80; c-basic-offset: 2; indent-tabs-mode: nil -*-
+/*
+    Copyright (c) 2010 Juan Jose Garcia Ripoll
+
+    Tensor is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published
+    by the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Library General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+
+#include <cstdlib>
+#include <algorithm>
+#include <string>
+#include <iostream>
+#include <unistd.h>
+#include <mps/environments.h>
+#include <mps/flags.h>
+
+namespace mps {
+
+  template<class Tensor>
+  EnvironmentStore<Tensor>::EnvironmentStore(const std::vector<slot_t> &slots) :
+    slot_(slots),
+    in_memory_(slots.size(), 1),
+    modified_(slots.size(), 1),
+    offset_(slots.size(), -1),
+    capacity_(slots.size(), 0),
+    window_(FLAGS.get(MPS_ENVIRONMENT_WINDOW)),
+    file_(0)
+  {
+    // Two-site algorithms need the bonds k-1 to k+2 around the front
+    if (window_ && window_ < 2)
+      window_ = 2;
+  }
+
+  template<class Tensor>
+  EnvironmentStore<Tensor>::~EnvironmentStore()
+  {
+    if (file_)
+      std::fclose(file_);
+  }
+
+  template<class Tensor>
+  const typename EnvironmentStore<Tensor>::slot_t &
+  EnvironmentStore<Tensor>::operator[](index k) const
+  {
+    fetch(k);
+    return slot_[k];
+  }
+
+  template<class Tensor>
+  typename EnvironmentStore<Tensor>::slot_t &
+  EnvironmentStore<Tensor>::modify(index k)
+  {
+    fetch(k);
+    modified_.at(k) = 1;
+    return slot_[k];
+  }
+
+  template<class Tensor>
+  index EnvironmentStore<Tensor>::resident_slots() const
+  {
+    index output = 0;
+    for (index k = 0; k < size(); k++) {
+      if (in_memory_[k]) output++;
+    }
+    return output;
+  }
+
+  template<class Tensor>
+  void EnvironmentStore<Tensor>::move_to(index k, int sense)
+  {
+    if (!window_)
+      return;
+    // Slots [first,last] stay in memory, with the bonds k and k+1 of the
+    // current site in the middle.
+    index first = (k > window_)? k - window_ : 0;
+    index last = std::min<index>(k + 1 + window_, size() - 1);
+    for (index n = 0; n < size(); n++) {
+      if (in_memory_[n] && (n < first || n > last))
+        write(n);
+    }
+    if (sense > 0) {
+      for (index n = k; n <= last; n++)
+        fetch(n);
+    } else {
+      for (index n = k + 1; n-- > first; )
+        fetch(n);
+    }
+  }
+
+  static void io_error(const char *where)
+  {
+    std::cerr << "In EnvironmentStore::" << where
+              << "(), unable to use scratch file.\n";
+    abort();
+  }
+
+  template<class Tensor>
+  void EnvironmentStore<Tensor>::write(index k)
+  {
+    typedef typename Tensor::elt_t number;
+    slot_t &slot = slot_[k];
+    if (modified_[k]) {
+      // Each tensor is saved as its rank, its dimensions and its data
+      std::vector<long> header;
+      long bytes = 0;
+      for (index i = 0; i < slot.size(); i++) {
+        const Tensor &t = slot[i];
+        long rank = t.is_empty()? 0 : t.rank();
+        header.push_back(rank);
+        for (long d = 0; d < rank; d++)
+          header.push_back(t.dimension(d));
+        bytes += rank? t.size() * sizeof(number) : 0;
+      }
+      bytes += header.size() * sizeof(long);
+      if (!file_) {
+        const char *dir = getenv("TMPDIR");
+        std::string name = std::string(dir? dir : "/tmp") + "/mpsXXXXXX";
+        std::vector<char> buffer(name.begin(), name.end());
+        buffer.push_back(0);
+        int fd = mkstemp(&buffer[0]);
+        if (fd < 0 || !(file_ = fdopen(fd, "w+b")))
+          io_error("write");
+        // The file is removed as soon as it is closed
+        unlink(&buffer[0]);
+      }
+      if (bytes > capacity_[k]) {
+        if (std::fseek(file_, 0, SEEK_END))
+          io_error("write");
+        offset_.at(k) = std::ftell(file_);
+        capacity_.at(k) = bytes;
+      } else if (std::fseek(file_, offset_[k], SEEK_SET)) {
+        io_error("write");
+      }
+      if (std::fwrite(&header[0], sizeof(long), header.size(), file_) != header.size())
+        io_error("write");
+      for (index i = 0; i < slot.size(); i++) {
+        const Tensor &t = slot[i];
+        if (!t.is_empty() &&
+            std::fwrite(t.begin(), sizeof(number), t.size(), file_) != t.size())
+          io_error("write");
+      }
+      modified_.at(k) = 0;
+    }
+    // Keep the number of tensors, so that the slot can be read back
+    slot = slot_t(slot.size());
+    in_memory_.at(k) = 0;
+  }
+
+  template<class Tensor>
+  void EnvironmentStore<Tensor>::fetch(index k) const
+  {
+    typedef typename Tensor::elt_t number;
+    if (in_memory_.at(k))
+      return;
+    slot_t &slot = slot_[k];
+    if (std::fseek(file_, offset_[k], SEEK_SET))
+      io_error("fetch");
+    // The header lists, for each tensor, its rank and its dimensions
+    std::vector<Indices> dims(slot.size());
+    for (index i = 0; i < slot.size(); i++) {
+      long rank, d;
+      if (std::fread(&rank, sizeof(long), 1, file_) != 1)
+        io_error("fetch");
+      dims.at(i) = Indices(rank);
+      for (long n = 0; n < rank; n++) {
+        if (std::fread(&d, sizeof(long), 1, file_) != 1)
+          io_error("fetch");
+        dims.at(i).at(n) = d;
+      }
+    }
+    for (index i = 0; i < slot.size(); i++) {
+      if (dims[i].size()) {
+        Tensor t(dims[i]);
+        if (std::fread(t.begin(), sizeof(number), t.size(), file_) != t.size())
+          io_error("fetch");
+        slot.at(i) = t;
+      }
+    }
+    in_memory_.at(k) = 1;
+  }
+
+} // namespace mps
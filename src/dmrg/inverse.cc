@@ -88,7 +88,7 @@ namespace mps {
     LinearForm<MPS> lf(canonical_form(apply(H, Q), -1), P, s.site());
 
     // QuadraticForm object implementing <P|H^2|P>
-    QuadraticForm<MPO> qf(mmult(adjoint(H), H), P, P, s.site());
+    QuadraticForm<MPO> qf(mmult_compressed(adjoint(H), H), P, P, s.site());
 
     Tensor Heff, vHQ, vP;
     while (sweeps--) {
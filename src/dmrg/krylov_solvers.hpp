@@ -0,0 +1,201 @@
+// -*- mode: c++; fill-column: 80; c-basic-offset: 2; indent-tabs-mode: nil -*-
+/*
+    Copyright (c) 2010 Juan Jose Garcia Ripoll
+
+    Tensor is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published
+    by the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Library General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <tensor/linalg.h>
+
+namespace mps {
+
+  /* Applies the inverse of a diagonal preconditioner, with entries that
+     are close to zero replaced by +-1e-8. An empty 'diagonal' means no
+     preconditioning. */
+  template<class Tensor>
+  const Tensor
+  precondition(const Tensor &diagonal, const Tensor &x)
+  {
+    if (diagonal.is_empty())
+      return x;
+    Tensor y = x;
+    for (index i = 0; i < x.size(); i++) {
+      typename Tensor::elt_t den = diagonal[i];
+      if (tensor::abs(den) < 1e-8) {
+        den = (real(den) < 0)? -1e-8 : 1e-8;
+      }
+      y.at(i) = x[i] / den;
+    }
+    return y;
+  }
+
+  /* Solves A x = b for a Hermitian, possibly indefinite, operator with the
+     MINRES method. 'A' is an object whose operator() applies the operator
+     onto a vector and 'diagonal' is either empty or holds a preconditioner,
+     which must be positive definite. On input '*x' is the initial guess
+     (it may be empty) and on output the solution, with the dimensions of
+     'b'. The iteration stops when the preconditioned residual is below
+     'tol' times that of the initial guess or after 'maxiter' applications
+     of 'A', which are added to '*matvecs'. The function returns true in
+     the first case. */
+  template<class Tensor, class Operator>
+  bool minres(const Operator &A, const Tensor &b, Tensor *x,
+              const Tensor &diagonal, double tol, index maxiter,
+              index *matvecs)
+  {
+    typedef typename Tensor::elt_t number;
+    index n = b.size();
+    Tensor xv = (x->size() == n)? reshape(*x, n) : Tensor::zeros(n);
+    Tensor r1 = reshape(b, n);
+    if (norm2(xv)) {
+      r1 = r1 - reshape(A(xv), n);
+      ++*matvecs;
+    }
+    Tensor y = precondition(diagonal, r1);
+    double beta1 = sqrt(tensor::abs(scprod(r1, y)));
+    bool converged = (beta1 == 0);
+    // Lanczos recurrence with the preconditioned vectors and QR
+    // factorization of the tridiagonal matrix with Givens rotations,
+    // as in Paige and Saunders.
+    Tensor r2 = r1, v, w = Tensor::zeros(n), w1, w2 = Tensor::zeros(n);
+    double oldb = 0, beta = beta1, dbar = 0, epsln = 0, phibar = beta1;
+    double cs = -1, sn = 0;
+    for (index iter = 0; !converged && iter < maxiter; iter++) {
+      v = y / beta;
+      y = reshape(A(v), n);
+      ++*matvecs;
+      if (iter)
+        y = y - number(beta / oldb) * r1;
+      double alfa = real(scprod(v, y));
+      y = y - number(alfa / beta) * r2;
+      r1 = r2;
+      r2 = y;
+      y = precondition(diagonal, r2);
+      oldb = beta;
+      beta = sqrt(tensor::abs(scprod(r2, y)));
+      double oldeps = epsln;
+      double delta = cs * dbar + sn * alfa;
+      double gbar = sn * dbar - cs * alfa;
+      epsln = sn * beta;
+      dbar = -cs * beta;
+      double gamma = std::max(sqrt(gbar * gbar + beta * beta), 1e-300);
+      cs = gbar / gamma;
+      sn = beta / gamma;
+      double phi = cs * phibar;
+      phibar = sn * phibar;
+      w1 = w2;
+      w2 = w;
+      w = (v - number(oldeps) * w1 - number(delta) * w2) / number(gamma);
+      xv += number(phi) * w;
+      if (phibar <= tol * beta1 || beta < 1e-14 * beta1) {
+        converged = true;
+      }
+    }
+    *x = reshape(xv, b.dimensions());
+    return converged;
+  }
+
+  /* Solves A x = b for a general operator with the GMRES method, restarted
+     every 'restart' iterations and with 'diagonal' (when not empty) as a
+     right preconditioner. The arguments are the same as for minres(), but
+     the iteration stops when the residual is below 'tol' times the norm
+     of 'b'. */
+  template<class Tensor, class Operator>
+  bool gmres(const Operator &A, const Tensor &b, Tensor *x,
+             const Tensor &diagonal, double tol, index maxiter,
+             index *matvecs, index restart = 30)
+  {
+    typedef typename Tensor::elt_t number;
+    index n = b.size();
+    Tensor bv = reshape(b, n);
+    Tensor xv = (x->size() == n)? reshape(*x, n) : Tensor::zeros(n);
+    double normb = norm2(bv);
+    bool converged = (normb == 0);
+    index iter = 0;
+    while (!converged && iter < maxiter) {
+      Tensor r = bv;
+      if (norm2(xv)) {
+        r = r - reshape(A(xv), n);
+        ++*matvecs;
+      }
+      double beta = norm2(r);
+      if (beta <= tol * normb) {
+        converged = true;
+        break;
+      }
+      // Arnoldi process, with the Hessenberg matrix H reduced to upper
+      // triangular form by Givens rotations (cs[j] real, sn[j] complex)
+      // as it is built, so that g[j+1] is the residual.
+      std::vector<Tensor> V(1, r / number(beta)), Z;
+      Tensor H = Tensor::zeros(restart + 1, restart);
+      std::vector<number> g(restart + 1, number(0.0)), sn(restart);
+      std::vector<double> cs(restart);
+      g[0] = beta;
+      index m = 0;
+      while (m < restart && iter < maxiter) {
+        Z.push_back(precondition(diagonal, V[m]));
+        Tensor w = reshape(A(Z[m]), n);
+        ++*matvecs;
+        ++iter;
+        for (index i = 0; i <= m; i++) {
+          H.at(i,m) = scprod(V[i], w);
+          w = w - H(i,m) * V[i];
+        }
+        double h = norm2(w);
+        H.at(m+1,m) = h;
+        for (index i = 0; i < m; i++) {
+          number a = H(i,m), c = H(i+1,m);
+          H.at(i,m) = cs[i] * a + sn[i] * c;
+          H.at(i+1,m) = cs[i] * c - tensor::conj(sn[i]) * a;
+        }
+        number a = H(m,m);
+        double rr = sqrt(tensor::abs(a) * tensor::abs(a) + h * h);
+        if (tensor::abs(a) == 0) {
+          cs[m] = 0;
+          sn[m] = 1.0;
+        } else {
+          cs[m] = tensor::abs(a) / rr;
+          sn[m] = a / tensor::abs(a) * (h / rr);
+        }
+        H.at(m,m) = cs[m] * a + sn[m] * h;
+        H.at(m+1,m) = 0;
+        g[m+1] = -tensor::conj(sn[m]) * g[m];
+        g[m] = cs[m] * g[m];
+        ++m;
+        if (tensor::abs(g[m]) <= tol * normb || h < 1e-14 * normb) {
+          converged = true;
+          break;
+        }
+        V.push_back(w / number(h));
+      }
+      // Back substitution and update of the solution
+      std::vector<number> c(m);
+      for (index i = m; i--; ) {
+        number s = g[i];
+        for (index j = i+1; j < m; j++) {
+          s -= H(i,j) * c[j];
+        }
+        c[i] = s / H(i,i);
+        xv += c[i] * Z[i];
+      }
+    }
+    *x = reshape(xv, b.dimensions());
+    return converged;
+  }
+
+} // namespace mps
@@ -61,7 +61,7 @@ namespace mps {
   typename LinearForm<MPS>::matrix_database_t
   LinearForm<MPS>::make_matrix_array()
   {
-    return matrix_database_t(number_of_bras(), matrix_array_t(size()+1, tensor_t()));
+    return matrix_database_t(size()+1, matrix_array_t(number_of_bras(), tensor_t()));
   }
 
   template<class tensor>
@@ -90,10 +90,11 @@ namespace mps {
       //           << "P=" << ketP << std::endl
       //           << "R=" << right_matrix(i,here())
       //           << std::endl;
-      right_matrix(i, here()-1) =
+      modify_right_matrix(i, here()-1) =
 	prop_matrix(right_matrix(i, here()), -1, bra_[i][here()], ketP);
     }
     --current_site_;
+    matrix_.move_to(here(), -1);
   }
 
   template<class MPS>
@@ -106,10 +107,11 @@ namespace mps {
       //           << "L=" << left_matrix(i,here()) << std::endl
       //           << "Q=" << bra_[i][here()] << std::endl
       //           << "P=" << ketP << std::endl;
-      left_matrix(i, here()+1) =
+      modify_left_matrix(i, here()+1) =
 	prop_matrix(left_matrix(i, here()), +1, bra_[i][here()], ketP);
     }
     ++current_site_;
+    matrix_.move_to(here(), +1);
   }
 
   template<class tensor_t>
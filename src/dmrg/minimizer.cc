@@ -17,43 +17,154 @@
     51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
 */
 
+#include <set>
+#include <cstdio>
+#include <fstream>
 #include <tensor/tools.h>
 #include <tensor/io.h>
 #include <tensor/linalg.h>
+#include <tensor/sdf.h>
 #include <mps/minimizer.h>
 #include <mps/mps_algorithms.h>
 #include <mps/qform.h>
+#include "davidson.hpp"
 
 namespace mps {
 
+  /* Effective Hamiltonian on one or two sites, applied by the quadratic
+     form onto a flattened tensor. When a projector is given, the vectors
+     only contain the elements of the tensor listed by it. */
   template<class Tensor, class QForm>
-  const Tensor apply_qform1(const Tensor &P, const Indices &d, const QForm *qform)
+  struct QFormOperator {
+    const QForm *qform;
+    int sites, sense;
+    Indices dimensions, projector;
+    const RTensor *qleft, *qright;
+
+    /* With the charges 'ql' and 'qr' of the outer bonds, the two-site
+       product is computed block by block. */
+    QFormOperator(const QForm *aqform, int asites, int asense,
+                  const Indices &d, const Indices &p = Indices(),
+                  const RTensor *ql = 0, const RTensor *qr = 0) :
+      qform(aqform), sites(asites), sense(asense), dimensions(d), projector(p),
+      qleft(ql), qright(qr)
+    {}
+
+    const Tensor operator()(const Tensor &v) const
+    {
+      Tensor P;
+      if (projector.size()) {
+        P = Tensor::zeros(dimensions);
+        P.at(range(projector)) = v;
+      } else {
+        P = reshape(v, dimensions);
+      }
+      if (sites == 1)
+        P = qform->apply_one_site_matrix(P);
+      else if (qleft)
+        P = qform->apply_two_site_matrix(P, sense, *qleft, *qright);
+      else
+        P = qform->apply_two_site_matrix(P, sense);
+      if (projector.size())
+        return P(range(projector));
+      return reshape(P, P.size());
+    }
+  };
+
+  template<class Tensor>
+  static const std::vector<Tensor>
+  load_tensors(sdf::InDataFile &file, const std::string &name)
   {
-    Tensor v = reshape(P, d);
-    v = qform->apply_one_site_matrix(v);
-    return reshape(v, P.size());
+    std::vector<Tensor> output;
+    file.load(&output, name);
+    return output;
   }
 
-  template<class Tensor, class QForm>
-  const Tensor apply_qform2_with_projector(const Tensor &P, int sense,
-                                           Tensor *P12, const QForm *qform,
-                                           const Indices &projector)
+  /* If the constraint is a sum of diagonal local operators, as those built by
+     local_Hamiltonian_mpo(), the diagonals are the U(1) charges of the
+     physical states on each site. Return false otherwise. */
+  template<class MPO>
+  static bool local_charges(const MPO &N, std::vector<RTensor> *q)
   {
-    // This is a bit fishy, because we reuse P12 as a buffer where to
-    // do the computation of H * psi. However, we rely on the fact that
-    // ARPACK is not multithreaded and thus apply_qform2_... is never
-    // concurrent on the same tensor.
-    P12->at(range(projector)) = P;
-    return qform->apply_two_site_matrix(*P12, sense)(range(projector));
+    typedef typename MPO::elt_t Tensor;
+    index L = N.size();
+    q->resize(L);
+    for (index k = 0; k < L; k++) {
+      index a, d, d2, b;
+      N[k].get_dimensions(&a, &d, &d2, &b);
+      if (a > 2 || b > 2)
+        return false;
+      bool last = (k+1 == L);
+      Tensor local = Tensor::zeros(d, d);
+      for (index n = 0; n < a; n++) {
+        for (index m = 0; m < b; m++) {
+          Tensor op = reshape(N[k](range(n), range(), range(), range(m)), d, d);
+          if (n == 0 && m == (last? 0 : 1)) {
+            local = op;
+          } else if (last? (n == 1 && m == 0) : (n == m)) {
+            if (norm2(op - Tensor::eye(d)) > 1e-12)
+              return false;
+          } else if (norm2(op) > 1e-12) {
+            return false;
+          }
+        }
+      }
+      Tensor diagonal = take_diag(local);
+      if (norm2(local - diag(diagonal)) > 1e-12)
+        return false;
+      q->at(k) = tensor::real(diagonal);
+    }
+    return true;
   }
 
-  template<class Tensor, class QForm>
-  const Tensor apply_qform2(const Tensor &P, int sense, const Indices &d,
-                            const QForm *qform)
+  /* Charge of the sites on the left of each bond of 'psi', which is in
+     canonical form with respect to the first site. We compute the charge of
+     the sites to the right of each bond; for states that do not conserve
+     it, the expectation value is replaced by the closest admissible one. */
+  template<class MPS>
+  static const std::vector<RTensor>
+  initial_bond_charges(const MPS &psi, const std::vector<RTensor> &q, double total)
   {
-    Tensor v = reshape(P, d);
-    v = qform->apply_two_site_matrix(v, sense);
-    return reshape(v, v.size());
+    typedef typename MPS::elt_t Tensor;
+    index L = psi.size();
+    std::vector<RTensor> output(L+1);
+    std::set<double> admissible;
+    admissible.insert(0.0);
+    RTensor right = RTensor::zeros(1);
+    output.at(L) = right + total;
+    for (index k = L-1; k > 0; k--) {
+      std::set<double> next;
+      for (std::set<double>::iterator it = admissible.begin();
+           it != admissible.end(); it++) {
+        for (index i = 0; i < q[k].size(); i++)
+          next.insert(*it + q[k][i]);
+      }
+      admissible.swap(next);
+
+      index a, d, b;
+      psi[k].get_dimensions(&a, &d, &b);
+      Tensor Pk = reshape(psi[k], a, d*b);
+      Tensor QPk = Pk;
+      scale_inplace(QPk, -1, kron2_sum(q[k], right));
+      RTensor values = tensor::real(take_diag(foldc(Pk, -1, QPk, -1)));
+      right = RTensor(a);
+      output.at(k) = RTensor(a);
+      for (index n = 0; n < a; n++) {
+        std::set<double>::iterator it = admissible.lower_bound(values[n]);
+        if (it == admissible.end()) {
+          --it;
+        } else if (it != admissible.begin()) {
+          std::set<double>::iterator prev = it;
+          --prev;
+          if (values[n] - *prev < *it - values[n])
+            it = prev;
+        }
+        right.at(n) = *it;
+        output.at(k).at(n) = total - *it;
+      }
+    }
+    output.at(0) = RTensor::zeros(1);
+    return output;
   }
 
   template<class MPO>
@@ -65,27 +176,79 @@ namespace mps {
     typedef QuadraticForm<mpo_t> qform_t;
 
     mps_t psi;
+    RTensor problem;
     qform_t Hqform, *Nqform;
+    std::vector<RTensor> Nlocal, Nbond;
     number_t Nvalue;
     double Ntol;
     index site;
     int step;
     bool converged;
-    mpo_t Hmpo;
+    std::vector<mpo_t> Hterms;
+    tensor_t Hweights;
+    double eig_tol;
+    index matvecs;
+    double alpha;
+    index sweep, failures;
+    double energy, discarded;
 
-    Minimizer(const MinimizerOptions &opt, const mpo_t &H, const mps_t &state) :
+    /* The Hamiltonian is the sum of the MPOs in 'H' times 'weights'. */
+    Minimizer(const MinimizerOptions &opt, const tensor_t &weights,
+              const std::vector<mpo_t> &H, const mps_t &state) :
       MinimizerOptions(opt),
       psi(canonical_form(state, -1)),
-      Hqform(H, psi, psi, 0),
+      Hqform(weights, H, psi, psi, 0),
       Nqform(0),
       Nvalue(0),
       Ntol(1e-6),
       site(0),
       step(+1),
       converged(true),
-      Hmpo(H)
+      Hterms(H),
+      Hweights(weights),
+      eig_tol(std::max(eigs_tolerance, 1e-4)),
+      matvecs(0),
+      alpha(expansion_alpha),
+      sweep(0),
+      failures(0),
+      energy(1e28),
+      discarded(0)
     {}
 
+    /* Resume the minimization from a file written by save_checkpoint(). */
+    Minimizer(const MinimizerOptions &opt, const tensor_t &weights,
+              const std::vector<mpo_t> &H, sdf::InDataFile &file) :
+      MinimizerOptions(opt),
+      psi(load_tensors<tensor_t>(file, "psi")),
+      Hqform(weights, H, file, "H"),
+      Nqform(0),
+      Nvalue(0),
+      Ntol(1e-6),
+      site(0),
+      step(+1),
+      converged(true),
+      Hterms(H),
+      Hweights(weights),
+      eig_tol(std::max(eigs_tolerance, 1e-4)),
+      matvecs(0),
+      alpha(expansion_alpha),
+      sweep(0),
+      failures(0),
+      energy(1e28),
+      discarded(0)
+    {
+      RTensor status;
+      file.load(&status, "status");
+      site = status[0];
+      step = status[1];
+      sweep = status[2];
+      failures = status[3];
+      energy = status[4];
+      eig_tol = status[5];
+      alpha = status[6];
+      Dmax = status[7];
+    }
+
     ~Minimizer()
     {
       if (Nqform) delete Nqform;
@@ -95,6 +258,19 @@ namespace mps {
       return psi.size();
     }
 
+    /* The Hamiltonian as a single MPO, only built for the eigenstate
+       fidelity. */
+    const mpo_t hamiltonian() const {
+      mpo_t H;
+      for (index t = 0; t < Hterms.size(); t++) {
+        mpo_t Ht = Hterms[t];
+        if (Hweights[t] != number_t(1.0))
+          Ht.at(0) = Hweights[t] * Ht[0];
+        H = t? add(H, Ht) : Ht;
+      }
+      return H;
+    }
+
     const mps_t &state() {
       return psi;
     }
@@ -102,27 +278,152 @@ namespace mps {
     void add_constraint(const mpo_t &constraint, number_t value)
     {
       if (Nqform) delete Nqform;
-      Nqform = new qform_t(constraint, psi, psi, 0);
+      Nqform = 0;
+      Nvalue = value;
+      // Sums of local diagonal operators are handled through the U(1)
+      // charges of the bonds; other constraints through their diagonal.
+      if (local_charges(constraint, &Nlocal)) {
+        Nbond = initial_bond_charges(psi, Nlocal, real(value));
+      } else {
+        Nlocal.clear();
+        Nqform = new qform_t(constraint, psi, psi, 0);
+      }
+    }
+
+    /* Read the constraint of a resumed minimization, which was saved
+       after the state of the sweeps. */
+    void load_constraint(const mpo_t &constraint, number_t value,
+                         sdf::InDataFile &file)
+    {
       Nvalue = value;
+      if (local_charges(constraint, &Nlocal)) {
+        file.load(&Nbond, "Nbond");
+      } else {
+        Nlocal.clear();
+        Nqform = new qform_t(constraint, file, "N");
+      }
+    }
+
+    /* Save the state, the position and direction of the sweeps, and the
+       environments. The file is written under a different name and then
+       renamed, so that a preempted job does not leave it corrupted. */
+    void save_checkpoint()
+    {
+      std::string tmp = checkpoint_file + ".tmp";
+      {
+        sdf::OutDataFile file(tmp);
+        file.dump(problem, "problem");
+        file.dump(psi.to_vector(), "psi");
+        Hqform.dump(file, "H");
+        RTensor status(8);
+        status.at(0) = site;
+        status.at(1) = step;
+        status.at(2) = sweep;
+        status.at(3) = failures;
+        status.at(4) = energy;
+        status.at(5) = eig_tol;
+        status.at(6) = alpha;
+        status.at(7) = Dmax;
+        file.dump(status, "status");
+        if (Nqform)
+          Nqform->dump(file, "N");
+        else if (!Nlocal.empty())
+          file.dump(Nbond, "Nbond");
+        file.close();
+      }
+      if (std::rename(tmp.c_str(), checkpoint_file.c_str())) {
+        std::cerr << "In Minimizer, unable to write checkpoint file "
+                  << checkpoint_file << std::endl;
+        abort();
+      }
+      if (debug) {
+        std::cout << "Checkpoint saved after sweep " << sweep << std::endl;
+      }
+    }
+
+    void remove_checkpoint()
+    {
+      if (checkpoint_every)
+        std::remove(checkpoint_file.c_str());
+    }
+
+    double eigensolver(const QFormOperator<tensor_t,qform_t> &H,
+                       const tensor_t &diagonal, tensor_t *P) {
+      double E;
+      index n = matvecs;
+      bool ok = davidson(H, diagonal, P, &E, eig_tol, eigs_maxiter, &matvecs);
+      if (debug > 1) {
+        std::cout << "\tsite=" << site << ", matvecs=" << matvecs - n
+                  << (ok? "" : ", Davidson did not converge") << std::endl;
+      }
+      if (!ok) {
+        converged = false;
+      }
+      return E;
     }
 
     double single_site_step() {
       tensor_t P = psi[site];
       const Indices d = P.dimensions();
-      tensor_t E = linalg::eigs(with_args(apply_qform1<tensor_t,qform_t>,
-                                          d, &Hqform),
-                                P.size(), linalg::SmallestAlgebraic, 1,
-                                &P, &converged);
-      if (converged) {
-        set_canonical(psi, site, reshape(P, d), step, false);
-        Hqform.propagate(psi[site], psi[site], step);
-        if (debug > 1) {
-          std::cout << "\tsite=" << site << ", E=" << real(E[0])
-                    << ", P.d" << psi[site].dimensions()
-                    << std::endl;
-        }
+      double E = eigensolver(QFormOperator<tensor_t,qform_t>(&Hqform, 1, step, d),
+                             Hqform.take_single_site_matrix_diag(), &P);
+      if (!converged) {
+        return E;
+      }
+      if (expansion() && (step > 0? site+1 < size() : site > 0))
+        expand_bond(P);
+      else
+        set_canonical(psi, site, P, step, false);
+      Hqform.propagate(psi[site], psi[site], step);
+      if (debug > 1) {
+        std::cout << "\tsite=" << site << ", E=" << E
+                  << ", P.d" << psi[site].dimensions()
+                  << std::endl;
+      }
+      return E;
+    }
+
+    /* Subspace expansion (Hubig et al, PRB 91, 155115 (2015)). The
+       optimized tensor P is enlarged along the bond in the direction of the
+       sweep with the expansion term of the Hamiltonian, times 'alpha', while
+       the neighbouring tensor is padded with zeros. The enlarged bond is
+       then truncated back with an SVD, keeping at most Dmax states. */
+    void expand_bond(const tensor_t &P) {
+      index a1, i, a2;
+      P.get_dimensions(&a1, &i, &a2);
+      tensor_t X = Hqform.expansion_term(P, step);
+      tensor_t U, V;
+      RTensor s;
+      if (step > 0) {
+        index ax = X.dimension(2);
+        tensor_t A = tensor_t::zeros(a1, i, a2+ax);
+        A.at(range(), range(), range(0, a2-1)) = P;
+        A.at(range(), range(), range(a2, a2+ax-1)) = alpha * X;
+        s = linalg::svd(reshape(A, a1*i, a2+ax), &U, &V, SVD_ECONOMIC);
+      } else {
+        index ax = X.dimension(0);
+        tensor_t A = tensor_t::zeros(a1+ax, i, a2);
+        A.at(range(0, a1-1), range(), range()) = P;
+        A.at(range(a1, a1+ax-1), range(), range()) = alpha * X;
+        s = linalg::svd(reshape(A, a1+ax, i*a2), &U, &V, SVD_ECONOMIC);
+      }
+      index D = where_to_truncate(s, svd_tolerance, Dmax);
+      if (D != s.size()) {
+        RTensor s2 = s * s;
+        discarded = std::max(discarded, 1.0 - sum(s2(range(0, D-1))) / sum(s2));
+        U = change_dimension(U, -1, D);
+        V = change_dimension(V, 0, D);
+        s = change_dimension(s, 0, D);
+      }
+      if (step > 0) {
+        scale_inplace(V, 0, s);
+        psi.at(site) = reshape(U, a1, i, D);
+        psi.at(site+1) = fold(V(range(), range(0, a2-1)), -1, psi[site+1], 0);
+      } else {
+        scale_inplace(U, -1, s);
+        psi.at(site) = reshape(V, D, i, a2);
+        psi.at(site-1) = fold(psi[site-1], -1, U(range(0, a1-1), range()), 0);
       }
-      return real(E[0]);
     }
 
     double single_site_sweep() {
@@ -144,7 +445,7 @@ namespace mps {
     }
 
     double two_site_step() {
-      tensor_t E;
+      double E;
       if (debug > 1) {
         if (step > 0) {
           std::cout << "\tsite=" << site << ", dimensions="
@@ -162,9 +463,33 @@ namespace mps {
         (step > 0) ?
         fold(psi[site], -1, psi[site+1], 0) :
         fold(psi[site-1], -1, psi[site], 0);
-      if (Nqform) {
+      if (Nqform || !Nlocal.empty()) {
         Indices projector;
-        {
+        RTensor qrow, qcol;
+        const RTensor *qleft = 0, *qright = 0;
+        if (!Nlocal.empty()) {
+          // The sites are (k,k+1). An element P12(a1,i,j,a3) is admissible
+          // when the charge it leaves on the bond (k,k+1), computed from the
+          // left and from the right, is the same.
+          index k = (step > 0)? site : site-1;
+          qrow = kron2_sum(Nbond[k], Nlocal[k]);
+          qcol = kron2_sum((-1.0) * Nlocal[k+1], Nbond[k+2]);
+          qleft = &Nbond[k];
+          qright = &Nbond[k+2];
+          projector = which(abs(kron2_sum(qrow, (-1.0) * qcol)) <
+                            FLAGS.get(MPS_CHARGE_TOLERANCE));
+          if (debug > 1) {
+            std::cout << "\tsite=" << site << ", constraints="
+                      << projector.size() << "/" << P12.size()
+                      << std::endl;
+          }
+          if (projector.size() == 0) {
+            std::cout << "Unable to satisfy constraint " << Nvalue
+                      << std::endl;
+            converged = false;
+            return 0.0;
+          }
+        } else {
           tensor_t aux = Nqform->take_two_site_matrix_diag(step);
           projector = which(abs(aux - Nvalue) < Ntol);
           if (debug > 1) {
@@ -181,37 +506,50 @@ namespace mps {
           }
         }
         tensor_t subP12 = P12(range(projector));
+        tensor_t diagonal =
+          flatten(Hqform.take_two_site_matrix_diag(step))(range(projector));
+        E = eigensolver(QFormOperator<tensor_t,qform_t>(&Hqform, 2, step,
+                                                        P12.dimensions(),
+                                                        projector, qleft,
+                                                        qright),
+                        diagonal, &subP12);
+        if (!converged) {
+          return E;
+        }
         P12.fill_with_zeros();
-        E = linalg::eigs(with_args(apply_qform2_with_projector<tensor_t,qform_t>,
-                                   step, &P12, &Hqform, projector),
-                         subP12.size(), linalg::SmallestAlgebraic, 1,
-                         &subP12, &converged);
         P12.at(range(projector)) = subP12;
-        if (converged) {
+        if (Nqform) {
           set_canonical_2_sites(psi, P12, site, step, Dmax, svd_tolerance,
                                 false);
+        } else {
+          index k = (step > 0)? site : site-1;
+          set_canonical_2_sites(psi, P12, site, step, qrow, qcol,
+                                &Nbond.at(k+1), Dmax, svd_tolerance);
         }
         Hqform.propagate(psi[site], psi[site], step);
-        Nqform->propagate(psi[site], psi[site], step);
+        if (Nqform)
+          Nqform->propagate(psi[site], psi[site], step);
       } else {
-        const Indices d = P12.dimensions();
-        E = linalg::eigs(with_args(apply_qform2<tensor_t,qform_t>,
-                                   step, d, &Hqform),
-                         P12.size(), linalg::SmallestAlgebraic, 1,
-                         &P12, &converged);
-        if (converged) {
-          set_canonical_2_sites(psi, reshape(P12, d), site, step, Dmax,
-                                svd_tolerance, false);
+        E = eigensolver(QFormOperator<tensor_t,qform_t>(&Hqform, 2, step,
+                                                        P12.dimensions()),
+                        Hqform.take_two_site_matrix_diag(step), &P12);
+        if (!converged) {
+          return E;
         }
+        set_canonical_2_sites(psi, P12, site, step, Dmax, svd_tolerance,
+                              false);
         Hqform.propagate(psi[site], psi[site], step);
       }
+      // P12 is normalized and the norm of what is kept moves to the
+      // neighbouring site.
+      discarded = std::max(discarded, 1.0 - square(norm2(psi[site+step])));
       if (debug > 1) {
-        std::cout << "\tsite=" << site << ", E=" << real(E[0])
+        std::cout << "\tsite=" << site << ", E=" << E
                   << ", P1.d=" << psi[site].dimensions()
                   << ", P2.d=" << psi[site+step].dimensions()
                   << std::endl;
       }
-      return real(E[0]);
+      return E;
     }
 
     double two_site_sweep() {
@@ -230,39 +568,91 @@ namespace mps {
       return E;
     }
 
+    template<class T>
+    static index length(const std::vector<T> &schedule) {
+      return schedule.size();
+    }
+
+    index schedules_length() {
+      return std::max(length(Dmax_schedule),
+                      std::max(length(svd_tolerance_schedule),
+                               length(eigs_tolerance_schedule)));
+    }
+
+    /* Options for the coming sweep. Once a schedule is over, its last
+       value remains, possibly changed by grow_Dmax(). */
+    void apply_schedules() {
+      if (sweep < Dmax_schedule.size())
+        Dmax = Dmax_schedule[sweep];
+      if (sweep < svd_tolerance_schedule.size())
+        svd_tolerance = svd_tolerance_schedule[sweep];
+      if (sweep < eigs_tolerance_schedule.size())
+        eig_tol = eigs_tolerance_schedule[sweep];
+    }
+
+    /* Enlarge Dmax when the last sweep discarded too much weight. */
+    bool grow_Dmax() {
+      if (!target_discarded_weight || !Dmax || discarded <= target_discarded_weight)
+        return false;
+      if (Dmax_limit && Dmax >= Dmax_limit)
+        return false;
+      Dmax += std::max<index>(Dmax / 2, 1);
+      if (Dmax_limit)
+        Dmax = std::min(Dmax, Dmax_limit);
+      return true;
+    }
+
     bool single_site() {
-      return !Dmax;
+      return !Dmax || expansion();
+    }
+
+    bool expansion() {
+      // The expansion does not keep track of the U(1) charges
+      return Dmax && subspace_expansion && !Nqform && Nlocal.empty();
     }
 
     double full_sweep(mps_t *psi, double &eig_fidelity, double &simp_err) {
-      double E = 1e28;
+      double E = energy;
       eig_fidelity = -1.;
       simp_err = -1.;
       if (debug) {
         std::cout << "***\n*** Algorithm with " << size() << " sites, "
                   << "two-sites = " << !single_site()
-                  << (Nqform? ", constrained" : ", unconstrained")
+                  << (expansion()? ", subspace expansion" : "")
+                  << (Nqform? ", constrained" :
+                      (Nlocal.empty()? ", unconstrained" : ", U(1) symmetric"))
+                  << (sweep? ", resumed" : "")
                   << std::endl;
       }
-      for (index failures = 0, i = 0; i < sweeps; i++) {
+      while (sweep < sweeps) {
+        index n = matvecs;
+        apply_schedules();
+        discarded = 0;
         double newE = single_site()? single_site_sweep() : two_site_sweep();
         if (debug) {
-          std::cout << "iteration=" << i << "; E=" << newE
+          std::cout << "iteration=" << sweep << "; E=" << newE
                     << "; dE=" << newE - E << "; tol=" << tolerance
+                    << "; eig_tol=" << eig_tol << "; matvecs=" << matvecs - n
+                    << "; Dmax=" << Dmax << "; discarded=" << discarded
                     << (converged? "" : "; did not converge!")
                     << std::endl;
         }
+        // While the schedules or the growth of Dmax change the problem,
+        // small changes of the energy do not signal convergence.
+        bool ramping = grow_Dmax() || (sweep+1 < schedules_length());
         if (!converged) {
+          remove_checkpoint();
           *psi = mps_t();
           return E;
         }
-        if (i) {
-          if (tensor::abs(newE-E) < tolerance) {
+        if (sweep) {
+          if (tensor::abs(newE-E) < tolerance && !ramping) {
             if (debug) {
               std::cout << "Reached tolerance dE=" << newE-E
                         << "<=" << tolerance << '\n' << std::flush;
               }
             E = newE;
+            remove_checkpoint();
             break;
           }
           if ((newE - E) > 1e-14*tensor::abs(newE)) {
@@ -271,17 +661,37 @@ namespace mps {
             }
             if (failures >= allow_E_growth) {
               E = newE;
+              remove_checkpoint();
               break;
             }
             failures++;
           }
+          // The local eigenvalue problems need not be solved much more
+          // accurately than what the energy changes between sweeps.
+          eig_tol = std::max(eigs_tolerance,
+                             std::min(eig_tol, 0.1*tensor::abs(newE-E)));
+          // The same for the perturbation of the subspace expansion,
+          // which must vanish as the energy converges.
+          alpha = std::max(expansion_alpha_min,
+                           std::min(alpha, tensor::abs(newE-E)));
+        }
+        energy = E = newE;
+        sweep++;
+        if (checkpoint_every && (sweep % checkpoint_every == 0)) {
+          save_checkpoint();
         }
-        E = newE;
       }
       *psi = state();
       // Compute the eigenstate fidelity
-      if (do_eigenstate_fidelity) {
-        eig_fidelity = eigenstate_fidelity(Hmpo, *psi, simp_err,
+      if (do_eigenstate_fidelity && exact_eigenstate_fidelity) {
+        eig_fidelity = eigenstate_fidelity(hamiltonian(), *psi, &E);
+        simp_err = 0.0;
+        if (debug) {
+          std::cout << "Eigenstate fidelity=" << eig_fidelity
+                    << '\n' << std::flush;
+        }
+      } else if (do_eigenstate_fidelity) {
+        eig_fidelity = eigenstate_fidelity(hamiltonian(), *psi, simp_err,
                                            simp_tol, simp_sweeps,
                                            simp_Dmax, &E);
         if (debug) {
@@ -295,4 +705,82 @@ namespace mps {
   };
 
 
+  /* Description of the problem saved with the checkpoints: the size, the
+     physical dimensions, the bond dimensions of every MPO and whether
+     there is a constraint. */
+  template<class MPO>
+  static const RTensor problem_fingerprint(const std::vector<MPO> &H,
+                                           const MPO *constraint)
+  {
+    std::vector<double> data;
+    index L = H.at(0).size();
+    data.push_back(L);
+    data.push_back(H.size());
+    data.push_back(constraint? 1 : 0);
+    for (index k = 0; k < L; k++) {
+      data.push_back(H[0][k].dimension(1));
+    }
+    for (index t = 0; t < H.size(); t++) {
+      for (index k = 0; k < L; k++) {
+        data.push_back(H[t][k].dimension(0));
+      }
+    }
+    if (constraint) {
+      for (index k = 0; k < L; k++) {
+        data.push_back((*constraint)[k].dimension(0));
+      }
+    }
+    RTensor output(data.size());
+    for (index n = 0; n < data.size(); n++) {
+      output.at(n) = data[n];
+    }
+    return output;
+  }
+
+  /* Run the minimization, resuming it from the checkpoint file when this
+     is requested and the file exists. A null 'constraint' means an
+     unconstrained minimization. */
+  template<class MPO>
+  static double do_minimize(const typename MPO::elt_t &weights,
+                            const std::vector<MPO> &H, typename MPO::MPS *psi,
+                            const MinimizerOptions &opt, const MPO *constraint,
+                            typename MPO::elt_t::elt_t value,
+                            double &eig_fidelity, double &simp_err)
+  {
+    RTensor problem = problem_fingerprint(H, constraint);
+    if (opt.checkpoint_every && opt.resume_from_checkpoint &&
+        std::ifstream(opt.checkpoint_file.c_str()).is_open()) {
+      sdf::InDataFile file(opt.checkpoint_file);
+      RTensor saved;
+      file.load(&saved, "problem");
+      if (saved.size() != problem.size() || !all_equal(saved, problem)) {
+        std::cerr << "In minimize(), the checkpoint file "
+                  << opt.checkpoint_file
+                  << " was written for a different problem.\n";
+        abort();
+      }
+      Minimizer<MPO> min(opt, weights, H, file);
+      min.problem = problem;
+      if (constraint)
+        min.load_constraint(*constraint, value, file);
+      return min.full_sweep(psi, eig_fidelity, simp_err);
+    } else {
+      Minimizer<MPO> min(opt, weights, H, *psi);
+      min.problem = problem;
+      if (constraint)
+        min.add_constraint(*constraint, value);
+      return min.full_sweep(psi, eig_fidelity, simp_err);
+    }
+  }
+
+  template<class MPO>
+  static double do_minimize(const MPO &H, typename MPO::MPS *psi,
+                            const MinimizerOptions &opt, const MPO *constraint,
+                            typename MPO::elt_t::elt_t value,
+                            double &eig_fidelity, double &simp_err)
+  {
+    return do_minimize(MPO::elt_t::ones(1), std::vector<MPO>(1, H), psi, opt,
+                       constraint, value, eig_fidelity, simp_err);
+  }
+
 } // namespace mps
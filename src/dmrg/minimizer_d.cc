@@ -25,34 +25,28 @@ namespace mps {
                   const RMPO &constraints, double value,
                   double &eig_fidelity, double &simp_err)
   {
-    Minimizer<RMPO> min(opt, H, *psi);
-    min.add_constraint(constraints, value);
-    return min.full_sweep(psi, eig_fidelity, simp_err);
+    return do_minimize(H, psi, opt, &constraints, value, eig_fidelity, simp_err);
   }
 
   double minimize(const RMPO &H, RMPS *psi, const MinimizerOptions &opt,
                   const RMPO &constraints, double value)
   {
-    Minimizer<RMPO> min(opt, H, *psi);
-    min.add_constraint(constraints, value);
     double eig_fidelity = -1.;
     double simp_err = -1.;
-    return min.full_sweep(psi, eig_fidelity, simp_err);
+    return do_minimize(H, psi, opt, &constraints, value, eig_fidelity, simp_err);
   }
 
   double minimize(const RMPO &H, RMPS *psi, const MinimizerOptions &opt,
                   double &eig_fidelity, double &simp_err)
   {
-    Minimizer<RMPO> min(opt, H, *psi);
-    return min.full_sweep(psi, eig_fidelity, simp_err);
+    return do_minimize<RMPO>(H, psi, opt, 0, 0.0, eig_fidelity, simp_err);
   }
 
   double minimize(const RMPO &H, RMPS *psi, const MinimizerOptions &opt)
   {
-    Minimizer<RMPO> min(opt, H, *psi);
-    double eig_fidelity =- 1.;
+    double eig_fidelity = -1.;
     double simp_err = -1.;
-    return min.full_sweep(psi, eig_fidelity, simp_err);
+    return do_minimize<RMPO>(H, psi, opt, 0, 0.0, eig_fidelity, simp_err);
   }
 
   double minimize(const RMPO &H, RMPS *psi,
@@ -68,4 +62,19 @@ namespace mps {
     return minimize(H, psi, MinimizerOptions(), eig_fidelity, simp_err);
   }
 
+  double minimize(const RTensor &weights, const std::vector<RMPO> &H,
+                  RMPS *psi, const MinimizerOptions &opt,
+                  double &eig_fidelity, double &simp_err)
+  {
+    return do_minimize<RMPO>(weights, H, psi, opt, 0, 0.0, eig_fidelity, simp_err);
+  }
+
+  double minimize(const RTensor &weights, const std::vector<RMPO> &H,
+                  RMPS *psi, const MinimizerOptions &opt)
+  {
+    double eig_fidelity = -1.;
+    double simp_err = -1.;
+    return do_minimize<RMPO>(weights, H, psi, opt, 0, 0.0, eig_fidelity, simp_err);
+  }
+
 } // namespace mps
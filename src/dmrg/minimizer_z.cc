@@ -25,34 +25,28 @@ namespace mps {
                   const CMPO &constraint, cdouble value,
                   double &eig_fidelity, double &simp_err)
   {
-    Minimizer<CMPO> min(opt, H, *psi);
-    min.add_constraint(constraint, value);
-    return min.full_sweep(psi, eig_fidelity, simp_err);
+    return do_minimize(H, psi, opt, &constraint, value, eig_fidelity, simp_err);
   }
 
   double minimize(const CMPO &H, CMPS *psi, const MinimizerOptions &opt,
                   const CMPO &constraint, cdouble value)
   {
-    Minimizer<CMPO> min(opt, H, *psi);
-    min.add_constraint(constraint, value);
     double eig_fidelity = -1.;
     double simp_err = -1.;
-    return min.full_sweep(psi, eig_fidelity, simp_err);
+    return do_minimize(H, psi, opt, &constraint, value, eig_fidelity, simp_err);
   }
 
   double minimize(const CMPO &H, CMPS *psi, const MinimizerOptions &opt,
                   double &eig_fidelity, double &simp_err)
   {
-    Minimizer<CMPO> min(opt, H, *psi);
-    return min.full_sweep(psi, eig_fidelity, simp_err);
+    return do_minimize<CMPO>(H, psi, opt, 0, 0.0, eig_fidelity, simp_err);
   }
 
   double minimize(const CMPO &H, CMPS *psi, const MinimizerOptions &opt)
   {
-    Minimizer<CMPO> min(opt, H, *psi);
     double eig_fidelity = -1.;
     double simp_err = -1.;
-    return min.full_sweep(psi, eig_fidelity, simp_err);
+    return do_minimize<CMPO>(H, psi, opt, 0, 0.0, eig_fidelity, simp_err);
   }
 
   double minimize(const CMPO &H, CMPS *psi,
@@ -68,4 +62,19 @@ namespace mps {
     return minimize(H, psi, MinimizerOptions(), eig_fidelity, simp_err);
   }
 
+  double minimize(const CTensor &weights, const std::vector<CMPO> &H,
+                  CMPS *psi, const MinimizerOptions &opt,
+                  double &eig_fidelity, double &simp_err)
+  {
+    return do_minimize<CMPO>(weights, H, psi, opt, 0, 0.0, eig_fidelity, simp_err);
+  }
+
+  double minimize(const CTensor &weights, const std::vector<CMPO> &H,
+                  CMPS *psi, const MinimizerOptions &opt)
+  {
+    double eig_fidelity = -1.;
+    double simp_err = -1.;
+    return do_minimize<CMPO>(weights, H, psi, opt, 0, 0.0, eig_fidelity, simp_err);
+  }
+
 } // namespace mps
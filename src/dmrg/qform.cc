@@ -18,6 +18,7 @@
 */
 
 #include <algorithm>
+#include <mps/flags.h>
 #include <mps/qform.h>
 #include <mps/mps_algorithms.h>
 #include <tensor/io.h>
@@ -27,8 +28,25 @@ namespace mps {
   template<class MPO>
   QuadraticForm<MPO>::QuadraticForm(const MPO &mpo, const mps_t &bra, const mps_t &ket, int start) :
     size_(mpo.size()),
-    matrix_(make_matrix_database(mpo)),
-    pairs_(make_pairs(mpo))
+    pairs_(mpo),
+    matrix_(make_matrix_database(pairs_))
+  {
+    initialize(bra, ket, start);
+  }
+
+  template<class MPO>
+  QuadraticForm<MPO>::QuadraticForm(const elt_t &weights, const std::vector<MPO> &mpos,
+                                    const mps_t &bra, const mps_t &ket, int start) :
+    size_(bra.size()),
+    pairs_(make_sum(weights, mpos)),
+    matrix_(make_matrix_database(pairs_))
+  {
+    initialize(bra, ket, start);
+  }
+
+  template<class MPO>
+  void
+  QuadraticForm<MPO>::initialize(const mps_t &bra, const mps_t &ket, int start)
   {
     // Boundary conditions not supported
     assert(bra[0].dimension(0) == 1 && ket[0].dimension(0) == 1);
@@ -44,17 +62,112 @@ namespace mps {
     // dump_matrices();
   }
 
+  template<class MPO>
+  QuadraticForm<MPO>::QuadraticForm(const MPO &mpo, sdf::InDataFile &file,
+                                    const std::string &name) :
+    size_(mpo.size()),
+    pairs_(mpo),
+    matrix_(load_matrix_database(pairs_, file, name))
+  {
+    load_site(file, name);
+  }
+
+  template<class MPO>
+  QuadraticForm<MPO>::QuadraticForm(const elt_t &weights, const std::vector<MPO> &mpos,
+                                    sdf::InDataFile &file, const std::string &name) :
+    size_(mpos.at(0).size()),
+    pairs_(make_sum(weights, mpos)),
+    matrix_(load_matrix_database(pairs_, file, name))
+  {
+    load_site(file, name);
+  }
+
+  template<class MPO>
+  void
+  QuadraticForm<MPO>::load_site(sdf::InDataFile &file, const std::string &name)
+  {
+    RTensor site;
+    file.load(&site, name + "_site");
+    current_site_ = site[0];
+    matrix_.move_to(here(), +1);
+  }
+
+  /* The sum is stored as a single sparse MPO, with the channels of the
+     terms side by side: the environments of each term are those of its
+     own channels and the loops over channels visit all terms. */
+  template<class MPO>
+  SparseMPO<typename QuadraticForm<MPO>::elt_t>
+  QuadraticForm<MPO>::make_sum(const elt_t &weights, const std::vector<MPO> &mpos)
+  {
+    if (mpos.empty() || weights.size() != mpos.size()) {
+      std::cerr << "In QuadraticForm(), the number of weights does not match "
+        "the number of MPOs.\n";
+      abort();
+    }
+    std::vector<SparseMPO<elt_t> > terms;
+    for (index t = 0; t < mpos.size(); t++) {
+      terms.push_back(SparseMPO<elt_t>(mpos[t]));
+    }
+    return SparseMPO<elt_t>(terms, weights);
+  }
+
+  template<class MPO>
+  void QuadraticForm<MPO>::dump(sdf::OutDataFile &file, const std::string &name)
+  {
+    // The file format does not support empty tensors. For every bond we
+    // save which environments exist, followed by the nonempty ones.
+    const EnvironmentStore<elt_t> &store = matrix_;
+    for (index k = 0; k < store.size(); k++) {
+      const matrix_array_t &slot = store[k];
+      RTensor mask = RTensor::zeros(slot.size());
+      matrix_array_t data;
+      for (index n = 0; n < slot.size(); n++) {
+        if (!slot[n].is_empty()) {
+          mask.at(n) = 1.0;
+          data.push_back(slot[n]);
+        }
+      }
+      file.dump(mask, name + "_mask");
+      file.dump(data, name + "_env");
+    }
+    file.dump(RTensor::ones(1) * double(here()), name + "_site");
+    matrix_.move_to(here(), +1);
+  }
+
+  template<class MPO>
+  typename QuadraticForm<MPO>::matrix_database_t
+  QuadraticForm<MPO>::load_matrix_database(const SparseMPO<elt_t> &mpo,
+                                           sdf::InDataFile &file,
+                                           const std::string &name)
+  {
+    matrix_database_t output = make_matrix_database(mpo);
+    for (index k = 0; k < output.size(); k++) {
+      RTensor mask;
+      matrix_array_t data;
+      file.load(&mask, name + "_mask");
+      file.load(&data, name + "_env");
+      if (mask.size() != output[k].size()) {
+        std::cerr << "In QuadraticForm(), the environments in the file do not "
+          "match the MPO.\n";
+        abort();
+      }
+      for (index n = 0, m = 0; n < mask.size(); n++) {
+        output.at(k).at(n) = mask[n]? data.at(m++) : elt_t();
+      }
+    }
+    return output;
+  }
+
   template<class MPO>
   typename QuadraticForm<MPO>::matrix_database_t
-  QuadraticForm<MPO>::make_matrix_database(const MPO &mpo)
+  QuadraticForm<MPO>::make_matrix_database(const SparseMPO<elt_t> &mpo)
   {
     // We only support open boundary condition problems
-    assert(mpo[0].dimension(0));
-    index d, L = mpo.size();
+    assert(mpo[0].left_dimension());
+    index L = mpo.size();
     matrix_database_t output(L+1);
-    typename MPO::elt_t tensor;
     for (index i = 1; i < L; i++) {
-      output.at(i) = matrix_array_t(mpo[i].dimension(0),elt_t());
+      output.at(i) = matrix_array_t(mpo[i].left_dimension(),elt_t());
     }
     output.at(0) = output.at(L) =
       matrix_array_t(1,elt_t::ones(1,1,1,1));
@@ -76,25 +189,6 @@ namespace mps {
   }
 
 
-  template<class MPO>
-  typename QuadraticForm<MPO>::pair_tree_t
-  QuadraticForm<MPO>::make_pairs(const MPO &mpo)
-  {
-    pair_tree_t output(mpo.size());
-    for (index m = 0; m < mpo.size(); m++) {
-      const elt_t &tensor = mpo[m];
-      for (index i = 0; i < tensor.dimension(0); i++) {
-	for (index j = 0; j < tensor.dimension(3); j++) {
-	  Pair p(i, j, tensor);
-	  if (!p.is_empty()) {
-	    output.at(m).push_back(p);
-          }
-	}
-      }
-    }
-    return output;
-  }
-
   template<class tensor>
   static void maybe_add(tensor *a, const tensor &b)
   {
@@ -104,37 +198,81 @@ namespace mps {
       *a += b;
   }
 
+  /* M += foldin(op, i, X, j) for the n-th operator of a site. Identities
+     are added without the product. X is only read and never shared by
+     reference, so that this may be used on shared tensors inside the
+     parallel loops below. */
+  template<class Site, class tensor>
+  static void add_op_product(tensor *M, const Site &t, index n, int i,
+                             const tensor &X, int j)
+  {
+    if (!t.identity[n])
+      maybe_add(M, foldin(t.op[n], i, X, j));
+    else if (M->is_empty())
+      *M = X * typename tensor::elt_t(1.0);
+    else
+      *M += X;
+  }
+
   template<class MPO>
   void QuadraticForm<MPO>::propagate(const elt_t &braP, const elt_t &ketP, int sense)
   {
     if (sense > 0) propagate_right(braP,ketP); else propagate_left(braP, ketP);
   }
 
+  /* The loops below are run in parallel with OpenMP. Environments, MPO
+     operators and states are shared among the threads, which only read them
+     through fold() and its variants; every reshaped view of a shared tensor is
+     created beforehand by the master thread. Each iteration writes to its
+     own slot of an array and the partial results are summed afterwards in
+     a fixed order, so that the outcome does not depend on the number of
+     threads. */
+
   template<class MPO>
   void QuadraticForm<MPO>::propagate_left(const elt_t &braP, const elt_t &ketP)
   {
     if (here() == 0)
       return;
     const matrix_array_t &mr = right_matrices(here());
-    matrix_array_t &new_mr = right_matrices(here()-1);
-    // std::cout << "Original right matrices\n";
-    // for (int i = 0; i < mr.size(); i++) {
-    //   std::cout << " mr[" << i << "]=" << mr[i] << std::endl;
-    // }
-    std::fill(new_mr.begin(), new_mr.end(), elt_t());
-    for (pair_iterator_t it = pairs_[here()].begin(), end = pairs_[here()].end();
-	 it != end;
-	 it++) {
-      if (!mr[it->right_ndx].is_empty()) {
-	maybe_add<elt_t>(&new_mr.at(it->left_ndx),
-			 prop_matrix(mr[it->right_ndx], -1, braP, ketP, &it->op));
+    matrix_array_t &new_mr = modify_right_matrices(here()-1);
+    const site_t &t = pairs_[here()];
+    // We implement this
+    // R'(a0,b0,a2,b2) = Q'(a0,i0,a1) O(i0,j0) P(b0,j0,b1) R(a1,b1,a2,b2)
+    // where a2=b2=1, because of open boundary conditions.
+    index a0, i0, a1, b0, j0, b1;
+    braP.get_dimensions(&a0, &i0, &a1);
+    ketP.get_dimensions(&b0, &j0, &b1);
+    const elt_t Q = reshape(braP, a0, i0*a1);
+    matrix_array_t Rm(mr.size()), PR(mr.size());
+    for (index b = 0; b < mr.size(); b++) {
+      if (!mr[b].is_empty() && t.right_start[b] < t.right_start[b+1])
+        Rm.at(b) = reshape(mr[b], a1, b1);
+    }
+    // PR(b)(b0,j0,a1) = P(b0,j0,b1) R(a1,b1)
+    index nb = mr.size();
+#pragma omp parallel for schedule(dynamic)
+    for (index b = 0; b < nb; b++) {
+      if (!Rm[b].is_empty())
+        PR.at(b) = fold(ketP, 2, Rm[b], 1);
+    }
+    // R'(a)(a0,b0) = Q'(a0,[i0,a1]) sum O(i0,j0) PR(b)(b0,j0,a1)
+    index na = new_mr.size();
+#pragma omp parallel for schedule(dynamic)
+    for (index a = 0; a < na; a++) {
+      elt_t M;
+      for (index n = t.left_start[a]; n < t.left_start[a+1]; n++) {
+        const elt_t &PRb = PR[t.right_ndx[n]];
+        if (!PRb.is_empty())
+          add_op_product(&M, t, n, -1, PRb, 1);
       }
+      if (M.is_empty())
+        new_mr.at(a) = elt_t();
+      else
+        new_mr.at(a) = reshape(foldc(Q, -1, reshape(M, b0, i0*a1), 1),
+                               a0, b0, 1, 1);
     }
-    // std::cout << "New matrix right locations\n";
-    // for (int i = 0; i < new_mr.size(); i++) {
-    //   std::cout << " mr'[" << i << "]=" << new_mr[i] << std::endl;
-    // }
     --current_site_;
+    matrix_.move_to(here(), -1);
   }
 
   template<class MPO>
@@ -143,24 +281,47 @@ namespace mps {
     if (here() == last_site())
       return;
     const matrix_array_t &ml = left_matrices(here());
-    matrix_array_t &new_ml = left_matrices(here()+1);
-    // std::cout << "Original left matrices\n";
-    // for (int i = 0; i < ml.size(); i++) {
-    //   std::cout << " ml[" << i << "]=" << ml[i] << std::endl;
-    // }
-    std::fill(new_ml.begin(), new_ml.end(), elt_t());
-    for (pair_iterator_t it = pairs_[here()].begin(), end = pairs_[here()].end();
-	 it != end;
-	 it++)
-      if (!ml[it->left_ndx].is_empty()) {
-	maybe_add<elt_t>(&new_ml.at(it->right_ndx),
-			 prop_matrix(ml[it->left_ndx], +1, braP, ketP, &it->op));
+    matrix_array_t &new_ml = modify_left_matrices(here()+1);
+    const site_t &t = pairs_[here()];
+    // We implement this
+    // L'(a1,b1,a3,b3) = L(a1,b1,a2,b2) Q'(a2,j2,a3) O(j2,i2) P(b2,i2,b3)
+    // where a1=b1=1, because of open boundary conditions.
+    index a2, j2, a3, b2, i2, b3;
+    braP.get_dimensions(&a2, &j2, &a3);
+    ketP.get_dimensions(&b2, &i2, &b3);
+    const elt_t Qc = tensor::conj(braP);
+    const elt_t P = reshape(ketP, b2*i2, b3);
+    matrix_array_t Lm(ml.size()), LQ(ml.size());
+    for (index a = 0; a < ml.size(); a++) {
+      if (!ml[a].is_empty() && t.left_start[a] < t.left_start[a+1])
+        Lm.at(a) = reshape(ml[a], a2, b2);
+    }
+    // LQ(a)(b2,j2,a3) = L(a2,b2) Q'(a2,j2,a3)
+    index na = ml.size();
+#pragma omp parallel for schedule(dynamic)
+    for (index a = 0; a < na; a++) {
+      if (!Lm[a].is_empty())
+        LQ.at(a) = fold(Lm[a], 0, Qc, 0);
+    }
+    // L'(b)(a3,b3) = sum O(j2,i2) LQ(a)(b2,j2,a3) P([b2,i2],b3)
+    index nb = new_ml.size();
+#pragma omp parallel for schedule(dynamic)
+    for (index b = 0; b < nb; b++) {
+      elt_t M;
+      for (index k = t.right_start[b]; k < t.right_start[b+1]; k++) {
+        index n = t.by_right[k];
+        const elt_t &LQa = LQ[t.left_ndx[n]];
+        if (!LQa.is_empty())
+          add_op_product(&M, t, n, 0, LQa, 1);
       }
-    // std::cout << "New matrix left locations\n";
-    // for (int i = 0; i < new_ml.size(); i++) {
-    //   std::cout << " ml'[" << i << "]=" << new_ml[i] << std::endl;
-    // }
+      if (M.is_empty())
+        new_ml.at(b) = elt_t();
+      else
+        new_ml.at(b) = reshape(fold(reshape(M, b2*i2, a3), 0, P, 0),
+                               1, 1, a3, b3);
+    }
     ++current_site_;
+    matrix_.move_to(here(), +1);
   }
 
   template<class elt_t>
@@ -201,15 +362,17 @@ namespace mps {
   QuadraticForm<MPO>::single_site_matrix() const
   {
     elt_t output;
-    for (pair_iterator_t it = pairs_[here()].begin(), end = pairs_[here()].end();
-	 it != end;
-	 it++)
-      {
-	const elt_t &vl = left_matrix(here(), it->left_ndx);
-	const elt_t &vr = right_matrix(here(), it->right_ndx);
-        if (!vl.is_empty() && !vr.is_empty())
-          maybe_add<elt_t>(&output, compose(vl, it->op, vr));
+    const site_t &t = pairs_[here()];
+    for (index a = 0; a < t.left_start.size() - 1; a++) {
+      const elt_t &vl = left_matrix(here(), a);
+      if (vl.is_empty())
+        continue;
+      for (index n = t.left_start[a]; n < t.left_start[a+1]; n++) {
+	const elt_t &vr = right_matrix(here(), t.right_ndx[n]);
+        if (!vr.is_empty())
+          maybe_add<elt_t>(&output, compose(vl, t.op[n], vr));
       }
+    }
     return output;
   }
 
@@ -229,20 +392,23 @@ namespace mps {
       assert(j > 0);
       i = j - 1;
     }
-    for (pair_iterator_t it1 = pairs_[i].begin(), end1 = pairs_[i].end();
-	 it1 != end1;
-	 it1++)
-      {
-	for (pair_iterator_t it2 = pairs_[j].begin(), end2 = pairs_[j].end();
-	     it2 != end2;
-	     it2++)
-	  if (it1->right_ndx == it2->left_ndx) {
-	    const elt_t &vl = left_matrix(i, it1->left_ndx);
-	    const elt_t &vr = right_matrix(j, it2->right_ndx);
-            if (!vl.is_empty() && !vr.is_empty())
-              maybe_add(&output, compose(vl, it1->op, it2->op, vr));
-	  }
+    const site_t &t1 = pairs_[i], &t2 = pairs_[j];
+    assert(t1.right_start.size() == t2.left_start.size());
+    // Operators on site 'i' that arrive at the inner bond 'm' are
+    // combined with the operators on site 'j' that leave from it.
+    for (index m = 0; m < t2.left_start.size() - 1; m++) {
+      for (index k = t1.right_start[m]; k < t1.right_start[m+1]; k++) {
+        index n1 = t1.by_right[k];
+        const elt_t &vl = left_matrix(i, t1.left_ndx[n1]);
+        if (vl.is_empty())
+          continue;
+        for (index n2 = t2.left_start[m]; n2 < t2.left_start[m+1]; n2++) {
+          const elt_t &vr = right_matrix(j, t2.right_ndx[n2]);
+          if (!vr.is_empty())
+            maybe_add(&output, compose(vl, t1.op[n1], t2.op[n2], vr));
+        }
       }
+    }
     return output;
   }
 
@@ -250,29 +416,55 @@ namespace mps {
   const typename QuadraticForm<MPO>::elt_t
   QuadraticForm<MPO>::apply_one_site_matrix(const elt_t &P) const
   {
-    elt_t output;
-    for (pair_iterator_t it = pairs_[here()].begin(), end = pairs_[here()].end();
-	 it != end;
-	 it++)
-      {
-        // L(a1,b1,a2,b2)
-        const elt_t &L = left_matrix(here(), it->left_ndx);
-        // R(a3,b3,a1,b1)
-        const elt_t &R = right_matrix(here(), it->right_ndx);
-        if (!L.is_empty() && !R.is_empty()) {
-          index a2 = L.dimension(2);
-          index b2 = L.dimension(3);
-          index a3 = R.dimension(0);
-          index b3 = R.dimension(1);
-          // We implement this
-          // Q(a2,i,a3) = L(a1,b1,a2,b2) O1(i,k) P(b2,k,b3) R(a3,b3,a1,b1)
-          // where a1=b1 = 1, because of periodic boundary conditions
-          elt_t Q =
-            fold(fold(reshape(L, a2,b2), 1, foldin(it->op, -1, P, 1), 0), 2,
-                 reshape(R, a3,b3), 1);
-          maybe_add(&output, Q);
-        }
+    // We implement this
+    // Q(a2,i,a3) = L(a1,b1,a2,b2) O1(i,k) P(b2,k,b3) R(a3,b3,a1,b1)
+    // where a1=b1 = 1, because of periodic boundary conditions.
+    // The right environments are contracted with P only once, and all
+    // operators sharing a left environment are summed before applying it.
+    const site_t &t = pairs_[here()];
+    const matrix_array_t &mr = right_matrices(here());
+    const matrix_array_t &ml = left_matrices(here());
+    matrix_array_t Rm(mr.size()), PR(mr.size());
+    for (index b = 0; b < mr.size(); b++) {
+      // R(a3,b3,a1,b1)
+      const elt_t &R = mr[b];
+      if (!R.is_empty() && t.right_start[b] < t.right_start[b+1])
+        Rm.at(b) = reshape(R, R.dimension(0), R.dimension(1));
+    }
+    index nb = mr.size();
+#pragma omp parallel for schedule(dynamic)
+    for (index b = 0; b < nb; b++) {
+      // PR(b2,k,a3) = P(b2,k,b3) R(a3,b3)
+      if (!Rm[b].is_empty())
+        PR.at(b) = fold(P, 2, Rm[b], 1);
+    }
+    matrix_array_t Lm(ml.size()), LZ(ml.size());
+    for (index a = 0; a < ml.size(); a++) {
+      // L(a1,b1,a2,b2)
+      const elt_t &L = ml[a];
+      if (!L.is_empty() && t.left_start[a] < t.left_start[a+1])
+        Lm.at(a) = reshape(L, L.dimension(2), L.dimension(3));
+    }
+    index na = ml.size();
+#pragma omp parallel for schedule(dynamic)
+    for (index a = 0; a < na; a++) {
+      if (Lm[a].is_empty())
+        continue;
+      // Z(b2,i,a3) = O1(i,k) PR(b2,k,a3)
+      elt_t Z;
+      for (index n = t.left_start[a]; n < t.left_start[a+1]; n++) {
+        const elt_t &PRb = PR[t.right_ndx[n]];
+        if (!PRb.is_empty())
+          add_op_product(&Z, t, n, -1, PRb, 1);
       }
+      if (!Z.is_empty())
+        LZ.at(a) = fold(Lm[a], 1, Z, 0);
+    }
+    elt_t output;
+    for (index a = 0; a < LZ.size(); a++) {
+      if (!LZ[a].is_empty())
+        maybe_add(&output, LZ[a]);
+    }
     return output;
   }
 
@@ -281,15 +473,16 @@ namespace mps {
   QuadraticForm<MPO>::take_single_site_matrix_diag() const
   {
     elt_t output;
-    for (pair_iterator_t it = pairs_[here()].begin(), end = pairs_[here()].end();
-	 it != end;
-	 it++)
-      {
-        // L(a1,b1,a2,b2)
-        const elt_t &L = left_matrix(here(), it->left_ndx);
+    const site_t &t = pairs_[here()];
+    for (index a = 0; a < t.left_start.size() - 1; a++) {
+      // L(a1,b1,a2,b2)
+      const elt_t &L = left_matrix(here(), a);
+      if (L.is_empty())
+        continue;
+      for (index n = t.left_start[a]; n < t.left_start[a+1]; n++) {
         // R(a3,b3,a1,b1)
-        const elt_t &R = right_matrix(here(), it->right_ndx);
-        if (!L.is_empty() && !R.is_empty()) {
+        const elt_t &R = right_matrix(here(), t.right_ndx[n]);
+        if (!R.is_empty()) {
           index a2 = L.dimension(2);
           index b2 = L.dimension(3);
           index a3 = R.dimension(0);
@@ -298,11 +491,12 @@ namespace mps {
           // Q(a2,i,a3) = L(a1,b1,a2,a2) O1(i,i) R(a3,a3,a1,b1)
           // where a1=b1 = 1, because of periodic boundary conditions
           elt_t Q = kron2_sum(kron2_sum(take_diag(reshape(L, a2,b2)),
-                                        take_diag(it->op)),
+                                        take_diag(t.op[n])),
                               take_diag(reshape(R, a3,b3)));
           maybe_add(&output, Q);
         }
       }
+    }
     return output;
   }
 
@@ -310,7 +504,126 @@ namespace mps {
   const typename QuadraticForm<MPO>::elt_t
   QuadraticForm<MPO>::apply_two_site_matrix(const elt_t &P12, int sense) const
   {
+    index i, j;
+    if (sense > 0) {
+      i = here();
+      j = i+1;
+      assert(j < size());
+    } else {
+      j = here();
+      assert(j > 0);
+      i = j - 1;
+    }
+    // We implement this
+    // Q12(a2,i,j,a3) = L(a1,b1,a2,b2) O1(i,k) O2(j,l)
+    //                     P12(b2,k,l,b3) R(a3,b3,a1,b1)
+    // where a1=b1 = 1, because of periodic boundary conditions.
+    // Instead of contracting the whole chain for every pair of operators
+    // we first build, for every inner bond 'm',
+    //   Y(m)(b2,k,j,a3) = sum O2(j,l) P12(b2,k,l,b3) R(a3,b3)
+    // over the operators of site 'j' that leave 'm', then
+    //   Z(a)(b2,i,j,a3) = sum O1(i,k) Y(m)(b2,k,j,a3)
+    // over the operators of site 'i' that go from 'a' to 'm', and finally
+    // apply each left environment L(a) once.
+    const site_t &t1 = pairs_[i], &t2 = pairs_[j];
+    assert(t1.right_start.size() == t2.left_start.size());
+    const matrix_array_t &mr = right_matrices(j);
+    const matrix_array_t &ml = left_matrices(i);
+    matrix_array_t Rm(mr.size());
+    for (index b = 0; b < mr.size(); b++) {
+      // R(a3,b3,a1,b1)
+      const elt_t &R = mr[b];
+      if (!R.is_empty() && t2.right_start[b] < t2.right_start[b+1])
+        Rm.at(b) = reshape(R, R.dimension(0), R.dimension(1));
+    }
+    matrix_array_t Y(t2.left_start.size() - 1);
+    index nm = Y.size();
+#pragma omp parallel for schedule(dynamic)
+    for (index m = 0; m < nm; m++) {
+      if (t1.right_start[m] == t1.right_start[m+1])
+        continue;
+      for (index n2 = t2.left_start[m]; n2 < t2.left_start[m+1]; n2++) {
+        const elt_t &R = Rm[t2.right_ndx[n2]];
+        if (R.is_empty())
+          continue;
+        if (t2.identity[n2])
+          maybe_add(&Y.at(m), fold(P12, 3, R, 1));
+        else
+          maybe_add(&Y.at(m), fold(foldin(t2.op[n2], -1, P12, 2), 3, R, 1));
+      }
+    }
+    matrix_array_t Lm(ml.size()), LZ(ml.size());
+    for (index a = 0; a < ml.size(); a++) {
+      // L(a1,b1,a2,b2)
+      const elt_t &L = ml[a];
+      if (!L.is_empty() && t1.left_start[a] < t1.left_start[a+1])
+        Lm.at(a) = reshape(L, L.dimension(2), L.dimension(3));
+    }
+    index na = ml.size();
+#pragma omp parallel for schedule(dynamic)
+    for (index a = 0; a < na; a++) {
+      if (Lm[a].is_empty())
+        continue;
+      elt_t Z;
+      for (index n1 = t1.left_start[a]; n1 < t1.left_start[a+1]; n1++) {
+        const elt_t &Ym = Y[t1.right_ndx[n1]];
+        if (!Ym.is_empty())
+          add_op_product(&Z, t1, n1, -1, Ym, 1);
+      }
+      if (!Z.is_empty())
+        LZ.at(a) = fold(Lm[a], 1, Z, 0);
+    }
     elt_t output;
+    for (index a = 0; a < LZ.size(); a++) {
+      if (!LZ[a].is_empty())
+        maybe_add(&output, LZ[a]);
+    }
+    return output;
+  }
+
+  /* Indices of a bond grouped by the charge that they carry. */
+  static const std::vector<Indices>
+  charge_sectors(const RTensor &q)
+  {
+    double qtol = FLAGS.get(MPS_CHARGE_TOLERANCE);
+    std::vector<double> charges;
+    std::vector<Indices> output;
+    for (index n = 0; n < q.size(); n++) {
+      bool found = false;
+      for (index m = 0; m < charges.size() && !found; m++)
+        found = (tensor::abs(charges[m] - q[n]) < qtol);
+      if (!found) {
+        charges.push_back(q[n]);
+        output.push_back(which(abs(q - q[n]) < qtol));
+      }
+    }
+    return output;
+  }
+
+  /* Blocks M(rows[s],cols[t]) of a matrix, stored at s + rows.size()*t,
+     leaving empty those that are zero. */
+  template<class tensor>
+  static const std::vector<tensor>
+  nonzero_blocks(const tensor &M, const std::vector<Indices> &rows,
+                 const std::vector<Indices> &cols)
+  {
+    std::vector<tensor> output(rows.size() * cols.size());
+    for (index t = 0; t < cols.size(); t++) {
+      for (index s = 0; s < rows.size(); s++) {
+        tensor B = tensor(M(range(rows[s]), range(cols[t])));
+        if (norm2(B) != 0)
+          output.at(s + rows.size() * t) = B;
+      }
+    }
+    return output;
+  }
+
+  template<class MPO>
+  const typename QuadraticForm<MPO>::elt_t
+  QuadraticForm<MPO>::apply_two_site_matrix(const elt_t &P12, int sense,
+                                            const RTensor &qleft,
+                                            const RTensor &qright) const
+  {
     index i, j;
     if (sense > 0) {
       i = here();
@@ -321,36 +634,108 @@ namespace mps {
       assert(j > 0);
       i = j - 1;
     }
-    for (pair_iterator_t it1 = pairs_[i].begin(), end1 = pairs_[i].end();
-	 it1 != end1;
-	 it1++)
-      {
-	for (pair_iterator_t it2 = pairs_[j].begin(), end2 = pairs_[j].end();
-	     it2 != end2;
-	     it2++)
-	  if (it1->right_ndx == it2->left_ndx) {
-            // L(a1,b1,a2,b2)
-	    const elt_t &L = left_matrix(i, it1->left_ndx);
-            // R(a3,b3,a1,b1)
-	    const elt_t &R = right_matrix(j, it2->right_ndx);
-            if (!L.is_empty() && !R.is_empty()) {
-              index a2 = L.dimension(2);
-              index b2 = L.dimension(3);
-              index a3 = R.dimension(0);
-              index b3 = R.dimension(1);
-              // We implement this
-              // Q12(a2,i,a3) = L(a1,b1,a2,b2) O1(i,k) O2(j,l)
-              //                     P12(b2,k,l,b3) R(a3,b3,a1,b1)
-              // where a1=b1 = 1, because of periodic boundary conditions
-              elt_t Q12 =
-                fold(fold(reshape(L, a2,b2), 1,
-                            foldin(it1->op, -1,
-                                   foldin(it2->op, -1, P12, 2), 1), 0), 3,
-                       reshape(R, a3,b3), 1);
-              maybe_add(&output, Q12);
-            }
-	  }
+    // This is the same contraction as apply_two_site_matrix(), done block
+    // by block. The outer bonds are split into the sectors 'sl' of qleft
+    // and 'sr' of qright. Since the state and the Hamiltonian conserve the
+    // charge, the blocks P12(u,t), R(s,t) and L(s,u) between most pairs of
+    // sectors are exactly zero, and are neither stored nor multiplied.
+    const site_t &t1 = pairs_[i], &t2 = pairs_[j];
+    assert(t1.right_start.size() == t2.left_start.size());
+    std::vector<Indices> sl = charge_sectors(qleft), sr = charge_sectors(qright);
+    index nl = sl.size(), nr = sr.size();
+    matrix_array_t P(nl * nr);
+    for (index t = 0; t < nr; t++) {
+      for (index u = 0; u < nl; u++) {
+        elt_t B = elt_t(P12(range(sl[u]), range(), range(), range(sr[t])));
+        if (norm2(B) != 0)
+          P.at(u + nl * t) = B;
+      }
+    }
+    const matrix_array_t &mr = right_matrices(j);
+    matrix_database_t Rb(mr.size());
+    for (index b = 0; b < mr.size(); b++) {
+      // R(a3,b3,a1,b1)
+      const elt_t &R = mr[b];
+      if (!R.is_empty() && t2.right_start[b] < t2.right_start[b+1])
+        Rb.at(b) = nonzero_blocks(reshape(R, R.dimension(0), R.dimension(1)),
+                                  sr, sr);
+    }
+    // Y(m)(u,s) = sum O2 P12(u,t) R(s,t)
+    matrix_database_t Y(t2.left_start.size() - 1);
+    index nm = Y.size();
+#pragma omp parallel for schedule(dynamic)
+    for (index m = 0; m < nm; m++) {
+      if (t1.right_start[m] == t1.right_start[m+1])
+        continue;
+      for (index n2 = t2.left_start[m]; n2 < t2.left_start[m+1]; n2++) {
+        const matrix_array_t &R = Rb[t2.right_ndx[n2]];
+        if (R.empty())
+          continue;
+        for (index k = 0; k < P.size(); k++) {
+          if (P[k].is_empty())
+            continue;
+          index u = k % nl, t = k / nl;
+          elt_t OP;
+          for (index s = 0; s < nr; s++) {
+            const elt_t &Rst = R[s + nr * t];
+            if (Rst.is_empty())
+              continue;
+            if (OP.is_empty())
+              OP = t2.identity[n2]? P[k] : foldin(t2.op[n2], -1, P[k], 2);
+            if (Y[m].empty())
+              Y.at(m).resize(nl * nr);
+            maybe_add(&Y.at(m).at(u + nl * s), fold(OP, 3, Rst, 1));
+          }
+        }
+      }
+    }
+    const matrix_array_t &ml = left_matrices(i);
+    matrix_database_t Lb(ml.size()), LZ(ml.size());
+    for (index a = 0; a < ml.size(); a++) {
+      // L(a1,b1,a2,b2)
+      const elt_t &L = ml[a];
+      if (!L.is_empty() && t1.left_start[a] < t1.left_start[a+1])
+        Lb.at(a) = nonzero_blocks(reshape(L, L.dimension(2), L.dimension(3)),
+                                  sl, sl);
+    }
+    index na = ml.size();
+#pragma omp parallel for schedule(dynamic)
+    for (index a = 0; a < na; a++) {
+      if (Lb[a].empty())
+        continue;
+      // Z(u,s) = sum O1 Y(m)(u,s)
+      matrix_array_t Z(nl * nr);
+      for (index n1 = t1.left_start[a]; n1 < t1.left_start[a+1]; n1++) {
+        const matrix_array_t &Ym = Y[t1.right_ndx[n1]];
+        for (index k = 0; k < Ym.size(); k++) {
+          if (!Ym[k].is_empty())
+            add_op_product(&Z.at(k), t1, n1, -1, Ym[k], 1);
+        }
+      }
+      LZ.at(a).resize(nl * nr);
+      for (index k = 0; k < Z.size(); k++) {
+        if (Z[k].is_empty())
+          continue;
+        index u = k % nl, s = k / nl;
+        for (index s2 = 0; s2 < nl; s2++) {
+          const elt_t &Lsu = Lb[a][s2 + nl * u];
+          if (!Lsu.is_empty())
+            maybe_add(&LZ.at(a).at(s2 + nl * s), fold(Lsu, 1, Z[k], 0));
+        }
+      }
+    }
+    matrix_array_t Q(nl * nr);
+    for (index a = 0; a < LZ.size(); a++) {
+      for (index k = 0; k < LZ[a].size(); k++) {
+        if (!LZ[a][k].is_empty())
+          maybe_add(&Q.at(k), LZ[a][k]);
       }
+    }
+    elt_t output = elt_t::zeros(P12.dimensions());
+    for (index k = 0; k < Q.size(); k++) {
+      if (!Q[k].is_empty())
+        output.at(range(sl[k % nl]), range(), range(), range(sr[k / nl])) = Q[k];
+    }
     return output;
   }
 
@@ -369,45 +754,94 @@ namespace mps {
       assert(j > 0);
       i = j - 1;
     }
-    for (pair_iterator_t it1 = pairs_[i].begin(), end1 = pairs_[i].end();
-	 it1 != end1;
-	 it1++)
-      {
-	for (pair_iterator_t it2 = pairs_[j].begin(), end2 = pairs_[j].end();
-	     it2 != end2;
-	     it2++) {
-	  if (it1->right_ndx == it2->left_ndx) {
-            // L(a1,b1,a2,b2)
-	    const elt_t &L = left_matrix(i, it1->left_ndx);
-            // R(a3,b3,a1,b1)
-	    const elt_t &R = right_matrix(j, it2->right_ndx);
-            if (!L.is_empty() && !R.is_empty()) {
-              index a2 = L.dimension(2);
-              index b2 = L.dimension(3);
-              index a3 = R.dimension(0);
-              index b3 = R.dimension(1);
-              // We implement this
-              // Q12(a2,i,j,a3) = L(a1,a1,a2,a2) O1(i,i) O2(j,j) R(a3,a3,a1,a1)
-              // where a1 = 1, because of periodic boundary conditions
-              elt_t Q12 = kron2(kron2(take_diag(reshape(L, a2,b2)),
-                                      take_diag(it1->op)),
-                                kron2(take_diag(it2->op),
-                                      take_diag(reshape(R,a3,b3))));
-              // std::cout << "L= " << matrix_form(take_diag(reshape(L, a2,b2)))
-              //           << std::endl
-              //           << "o1=" << matrix_form(take_diag(it1->op))
-              //           << std::endl
-              //           << "o2=" << matrix_form(take_diag(it2->op))
-              //           << std::endl
-              //           << "R= " << matrix_form(take_diag(reshape(R, a3,b3)))
-              //           << std::endl;
-              // std::cout << "Q= " << matrix_form(Q12) << std::endl;
-              maybe_add(&output, Q12);
-            }
-	  }
+    const site_t &t1 = pairs_[i], &t2 = pairs_[j];
+    assert(t1.right_start.size() == t2.left_start.size());
+    for (index m = 0; m < t2.left_start.size() - 1; m++) {
+      for (index k = t1.right_start[m]; k < t1.right_start[m+1]; k++) {
+        index n1 = t1.by_right[k];
+        // L(a1,b1,a2,b2)
+        const elt_t &L = left_matrix(i, t1.left_ndx[n1]);
+        if (L.is_empty())
+          continue;
+        for (index n2 = t2.left_start[m]; n2 < t2.left_start[m+1]; n2++) {
+          // R(a3,b3,a1,b1)
+          const elt_t &R = right_matrix(j, t2.right_ndx[n2]);
+          if (!R.is_empty()) {
+            index a2 = L.dimension(2);
+            index b2 = L.dimension(3);
+            index a3 = R.dimension(0);
+            index b3 = R.dimension(1);
+            // We implement this
+            // Q12(a2,i,j,a3) = L(a1,a1,a2,a2) O1(i,i) O2(j,j) R(a3,a3,a1,a1)
+            // where a1 = 1, because of periodic boundary conditions
+            elt_t Q12 = kron2(kron2(take_diag(reshape(L, a2,b2)),
+                                    take_diag(t1.op[n1])),
+                              kron2(take_diag(t2.op[n2]),
+                                    take_diag(reshape(R,a3,b3))));
+            maybe_add(&output, Q12);
+          }
         }
       }
+    }
     return output;
   }
 
+  template<class MPO>
+  const typename QuadraticForm<MPO>::elt_t
+  QuadraticForm<MPO>::expansion_term(const elt_t &P, int sense) const
+  {
+    const site_t &t = pairs_[here()];
+    index a1, i, a2;
+    P.get_dimensions(&a1, &i, &a2);
+    elt_t output;
+    if (sense > 0) {
+      // X(w)(a1,i,a2) = L(a)(1,1,a1,b1) O(i,j) P(b1,j,a2)
+      // summed over the operators that go from 'a' to 'w'
+      const matrix_array_t &ml = left_matrices(here());
+      matrix_array_t LP(ml.size());
+      for (index a = 0; a < ml.size(); a++) {
+        const elt_t &L = ml[a];
+        if (!L.is_empty() && t.left_start[a] < t.left_start[a+1])
+          LP.at(a) = fold(reshape(L, L.dimension(2), L.dimension(3)), 1, P, 0);
+      }
+      index W = t.right_start.size() - 1;
+      output = elt_t::zeros(a1, i, a2, W);
+      for (index w = 0; w < W; w++) {
+        elt_t X;
+        for (index k = t.right_start[w]; k < t.right_start[w+1]; k++) {
+          index n = t.by_right[k];
+          const elt_t &LPa = LP[t.left_ndx[n]];
+          if (!LPa.is_empty())
+            add_op_product(&X, t, n, -1, LPa, 1);
+        }
+        if (!X.is_empty())
+          output.at(range(), range(), range(), range(w)) = reshape(X, a1,i,a2,1);
+      }
+      return reshape(output, a1, i, a2*W);
+    } else {
+      // Y(w)(a1,i,a2) = O(i,j) P(a1,j,b2) R(b)(a2,b2,1,1)
+      // summed over the operators that go from 'w' to 'b'
+      const matrix_array_t &mr = right_matrices(here());
+      matrix_array_t PR(mr.size());
+      for (index b = 0; b < mr.size(); b++) {
+        const elt_t &R = mr[b];
+        if (!R.is_empty() && t.right_start[b] < t.right_start[b+1])
+          PR.at(b) = fold(P, 2, reshape(R, R.dimension(0), R.dimension(1)), 1);
+      }
+      index W = t.left_start.size() - 1;
+      output = elt_t::zeros(a1, W, i, a2);
+      for (index w = 0; w < W; w++) {
+        elt_t Y;
+        for (index n = t.left_start[w]; n < t.left_start[w+1]; n++) {
+          const elt_t &PRb = PR[t.right_ndx[n]];
+          if (!PRb.is_empty())
+            add_op_product(&Y, t, n, -1, PRb, 1);
+        }
+        if (!Y.is_empty())
+          output.at(range(), range(w), range(), range()) = reshape(Y, a1,1,i,a2);
+      }
+      return reshape(output, a1*W, i, a2);
+    }
+  }
+
 }
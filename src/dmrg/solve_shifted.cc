@@ -0,0 +1,142 @@
+// -*- mode: c++; fill-column: 80; c-basic-offset: 2; indent-tabs-mode: nil -*-
+/*
+    Copyright (c) 2010 Juan Jose Garcia Ripoll
+
+    Tensor is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published
+    by the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Library General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include <algorithm>
+#include <mps/flags.h>
+#include <mps/mps.h>
+#include <mps/mps_algorithms.h>
+#include <mps/qform.h>
+#include <mps/lform.h>
+#include <tensor/io.h>
+#include "krylov_solvers.hpp"
+
+namespace mps {
+
+  /* The two-site effective operator of 'H - shift' around sites (k,k+1)
+     (sense > 0) or (k-1,k) (sense < 0), acting on vectors. */
+  template<class MPO>
+  struct ShiftedTwoSiteOperator {
+    typedef typename QuadraticForm<MPO>::elt_t elt_t;
+    typedef typename elt_t::elt_t number;
+
+    ShiftedTwoSiteOperator(QuadraticForm<MPO> *qf, number shift, int sense,
+                           const Indices &dimensions) :
+      qf_(qf), shift_(shift), sense_(sense), dimensions_(dimensions)
+    {}
+
+    const elt_t operator()(const elt_t &x) const {
+      elt_t P = reshape(x, dimensions_);
+      return qf_->apply_two_site_matrix(P, sense_) - shift_ * P;
+    }
+
+    QuadraticForm<MPO> *qf_;
+    number shift_;
+    int sense_;
+    Indices dimensions_;
+  };
+
+  /*
+   * We solve (H - shift) * P = Q without squaring H. When all tensors of
+   * P other than those on sites (k,k+1) are in canonical form, the
+   * projection of the equation onto those two sites is
+   *	(Heff - shift) P(k,k+1) = <P|Q>(k,k+1)
+   * where Heff is the two-site matrix of the QuadraticForm <P|H|P> and
+   * the right-hand side is the LinearForm <P|Q>. For a real shift this
+   * local problem is Hermitian and is solved with MINRES; otherwise with
+   * GMRES. Both use the diagonal of Heff - shift as preconditioner when
+   * MPS_SOLVE_PRECONDITION is set.
+   */
+  template<class MPO, class MPS>
+  static double
+  do_solve_shifted(const MPO &H, typename MPS::elt_t::elt_t shift, MPS *ptrP,
+                   const MPS &oQ, index sweeps, index Dmax, double tol)
+  {
+    typedef typename MPS::elt_t Tensor;
+    typedef typename Tensor::elt_t number;
+    bool debug = FLAGS.get(MPS_DEBUG_SOLVE);
+    bool use_diagonal = FLAGS.get(MPS_SOLVE_PRECONDITION);
+    bool hermitian = (number(real(shift)) == shift);
+    index L = oQ.size();
+
+    if (tol <= 0) {
+      tol = FLAGS.get(MPS_SOLVE_TOLERANCE);
+    }
+    assert(sweeps > 0);
+    assert(ptrP);
+    MPS Q = canonical_form(oQ, -1);
+    double normQ = norm2(Q[0]);
+    if (normQ < 1e-8) {
+      std::cerr << "Right-hand side in solve_shifted(MPO, ...) is zero\n";
+      abort();
+    }
+    MPS &P = *ptrP;
+    P = canonical_form(P.size()? P : Q, -1);
+
+    QuadraticForm<MPO> qf(H, P, P, 0);
+    LinearForm<MPS> lf(Q, P, 0);
+    double err = 0;
+    number scp = 0, oldscp;
+    index matvecs = 0;
+    while (sweeps--) {
+      err = 0;
+      for (int sweep_sense = +1; sweep_sense >= -1; sweep_sense -= 2) {
+        for (index n = 1; n < L; n++) {
+          index k = (sweep_sense > 0)? n-1 : L-n;
+          index k1 = k, k2 = k+sweep_sense;
+          if (sweep_sense < 0) std::swap(k1, k2);
+          Tensor vQ = conj(lf.two_site_vector(sweep_sense));
+          Tensor vP = fold(P[k1], -1, P[k2], 0);
+          ShiftedTwoSiteOperator<MPO> A(&qf, shift, sweep_sense,
+                                        vP.dimensions());
+          Tensor diagonal;
+          if (use_diagonal) {
+            diagonal = flatten(qf.take_two_site_matrix_diag(sweep_sense));
+            for (index i = 0; i < diagonal.size(); i++) {
+              diagonal.at(i) -= shift;
+              if (hermitian)
+                diagonal.at(i) = tensor::abs(diagonal[i]);
+            }
+          }
+          if (hermitian) {
+            minres(A, vQ, &vP, diagonal, tol, 2*vQ.size(), &matvecs);
+          } else {
+            gmres(A, vQ, &vP, diagonal, tol, 2*vQ.size(), &matvecs);
+          }
+          err = std::max(err, norm2(A(vP) - vQ) / normQ);
+          set_canonical_2_sites(P, vP, k, sweep_sense, Dmax, tol, false);
+          qf.propagate(P[k], P[k], sweep_sense);
+          lf.propagate(P[k], sweep_sense);
+        }
+      }
+      // The overlap <Q|P> is the quantity of interest in correction-vector
+      // and Green's function calculations.
+      oldscp = scp;
+      scp = scprod(Q, P);
+      if (debug) {
+        std::cout << "[mps::solve_shifted] sweeps=" << sweeps << ", err=" << err
+                  << ", <Q|P>=" << scp << ", matvecs=" << matvecs << std::endl;
+      }
+      if (tensor::abs(scp - oldscp) <= tol * tensor::abs(scp)) {
+        break;
+      }
+    }
+    return err;
+  }
+
+} // namespace mps
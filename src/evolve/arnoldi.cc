@@ -48,20 +48,35 @@ namespace mps {
     }
   }
 
+  /* H|psi> for a new Krylov vector. When the bond dimension is limited,
+     the product is fitted directly to the size that the Krylov vectors
+     are simplified to below. */
+  const CMPS
+  ArnoldiSolver::apply_krylov(const CMPS &psi, index Dmax) const
+  {
+    if (Dmax) {
+      return apply_and_compress(H_, psi, 2*Dmax);
+    } else {
+      return apply(H_, psi);
+    }
+  }
+
   double
   ArnoldiSolver::one_step(CMPS *psi, index Dmax)
   {
     CTensor N = CTensor::zeros(max_states_, max_states_);
     CTensor Heff = N;
     CMPS current = normal_form(*psi, -1);
-    CMPS Hcurrent = apply(H_, current);
+    CMPS Hcurrent = apply_krylov(current, Dmax);
     int debug = mps::FLAGS.get(MPS_DEBUG_ARNOLDI);
 
     std::vector<CMPS> states;
     states.reserve(max_states_);
     states.push_back(current);
     N.at(0,0) = to_complex(1.0);
-    Heff.at(0,0) = real(scprod(current, Hcurrent));
+    /* The matrix elements are computed exactly. Hcurrent is only used to
+       build the next Krylov vector, and may have been truncated. */
+    Heff.at(0,0) = real(expected(current, H_, current));
 
     std::vector<CMPS> vectors(3);
     std::vector<cdouble> coeffs(3);
@@ -130,16 +145,16 @@ namespace mps {
       //    Also compute the matrix elements of the Hamiltonian in this new basis.
       //
       states.push_back(current);
-      Hcurrent = apply(H_, current);
+      Hcurrent = apply_krylov(current, Dmax);
       for (int n = 0; n < ndx; n++) {
 	cdouble aux;
 	N.at(n, ndx) = aux = scprod(states[n], current);
 	N.at(ndx, n) = tensor::conj(aux);
-	Heff.at(n, ndx) = aux = scprod(states[n], Hcurrent);
+	Heff.at(n, ndx) = aux = expected(states[n], H_, current);
 	Heff.at(ndx, n) = tensor::conj(aux);
       }
       N.at(ndx, ndx) = 1.0;
-      Heff.at(ndx, ndx) = real(scprod(current, Hcurrent));
+      Heff.at(ndx, ndx) = real(expected(current, H_, current));
     }
     //
     // 2) Once we have the basis, we compute the exponential on it. Notice that, since
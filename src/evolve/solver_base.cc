@@ -29,4 +29,35 @@ namespace mps {
   {
   }
 
+  double
+  TrotterSolver::evolve(CMPS *P, index nsteps, index Dmax)
+  {
+    double err = 0.0;
+    for (index n = 0; n < nsteps; n++) {
+      err += one_step(P, Dmax);
+    }
+    return err;
+  }
+
+  double
+  TrotterSolver::apply_layer(const Unitary &U, CMPS *P, int *sense,
+                             double tolerance, index Dmax, bool group_end,
+                             bool normalize_output) const
+  {
+    switch (strategy) {
+    case TRUNCATE_EACH_UNITARY:
+      return U.apply(P, sense, tolerance, Dmax, normalize_output);
+    case TRUNCATE_EACH_LAYER:
+      return U.apply_and_simplify(P, sense, tolerance, Dmax, normalize_output);
+    case DO_NOT_TRUNCATE:
+      return U.apply(P, sense, tolerance, 0, normalize_output);
+    default:
+      if (group_end) {
+        return U.apply_and_simplify(P, sense, tolerance, Dmax,
+                                    normalize_output);
+      }
+      return U.apply(P, sense, tolerance, 0, normalize_output);
+    }
+  }
+
 } // namespace mps
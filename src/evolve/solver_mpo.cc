@@ -0,0 +1,52 @@
+// -*- mode: c++; fill-column: 80; c-basic-offset: 2; indent-tabs-mode: nil -*-
+/*
+    Copyright (c) 2010 Juan Jose Garcia Ripoll
+
+    Tensor is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published
+    by the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Library General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include <mps/mps.h>
+#include <mps/mps_algorithms.h>
+#include <mps/time_evolve.h>
+
+namespace mps {
+
+  MPOSolver::MPOSolver(const Hamiltonian &H, cdouble dt, int method) :
+    TimeSolver(dt), sweeps(4), normalize(true),
+    tolerance(MPS_TIME_EVOLVE_TOLERANCE),
+    U_(exponential_mpo(CMPO(H, 0.0), to_complex(0.0, -1.0) * dt, method))
+  {
+  }
+
+  MPOSolver::MPOSolver(const CMPO &H, cdouble dt, int method) :
+    TimeSolver(dt), sweeps(4), normalize(true),
+    tolerance(MPS_TIME_EVOLVE_TOLERANCE),
+    U_(exponential_mpo(H, to_complex(0.0, -1.0) * dt, method))
+  {
+  }
+
+  double
+  MPOSolver::one_step(CMPS *P, index Dmax)
+  {
+    double err = 0;
+    *P = apply_and_compress(U_, *P, Dmax, tolerance, sweeps, &err);
+    if (normalize) {
+      // The output is in canonical form with respect to the first site
+      P->at(0) = (*P)[0] / norm2((*P)[0]);
+    }
+    return err;
+  }
+
+} // namespace mps
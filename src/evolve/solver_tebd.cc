@@ -0,0 +1,164 @@
+// -*- mode: c++; fill-column: 80; c-basic-offset: 2; indent-tabs-mode: nil -*-
+/*
+    Copyright (c) 2010 Juan Jose Garcia Ripoll
+
+    Tensor is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published
+    by the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Library General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include <tensor/linalg.h>
+#include <mps/mps.h>
+#include <mps/tools.h>
+#include <mps/time_evolve.h>
+
+namespace mps {
+
+  /**********************************************************************
+   * TEBD on the Vidal form, with the second order decomposition
+   *
+   *	exp(-iHdt) = exp(-iH_even dt/2) exp(-iH_odd dt) exp(-iH_even dt/2)
+   *
+   * where H_even and H_odd are sums of the bond terms
+   *
+   *	H_{kk+1} = Hint_{kk+1} + w_k Hloc_{k} + w_{k+1} Hloc_{k+1}
+   *
+   * and the weights w are 1/2, except at the ends of the chain.
+   */
+
+  TEBDSolver::TEBDSolver(const Hamiltonian &H, cdouble dt) :
+    TimeSolver(dt), tolerance(MPS_TIME_EVOLVE_TOLERANCE), U_(H.size() - 1)
+  {
+    index L = H.size();
+    if (L < 2) {
+      std::cerr << "In TEBDSolver(...), the Hamiltonian has less than two sites\n";
+      abort();
+    }
+    dt = to_complex(-tensor::abs(imag(dt)), -real(dt));
+    for (index k = 0; k+1 < L; k++) {
+      CTensor i1 = CTensor::eye(H.dimension(k));
+      CTensor i2 = CTensor::eye(H.dimension(k+1));
+      double w1 = (k == 0)? 1.0 : 0.5;
+      double w2 = (k+2 == L)? 1.0 : 0.5;
+      CTensor Hk = H.interaction(k, 0.0)
+        + kron2(w1 * H.local_term(k, 0.0), i2)
+        + kron2(i1, w2 * H.local_term(k+1, 0.0));
+      U_.at(k) = linalg::expm(Hk * ((k & 1)? dt : dt / 2.0));
+    }
+  }
+
+  /* Right-canonical tensors in the Schmidt basis of every bond. Starting
+     from the left-canonical form, a sweep of SVDs from the right gives both
+     the tensors and the Schmidt vectors. */
+  void
+  TEBDSolver::set_state(const CMPS &P)
+  {
+    index L = P.size();
+    CMPS Q = canonical_form(P, +1);
+    B_.resize(L);
+    lambda_.resize(L);
+    RTensor one(1);
+    one.at(0) = 1.0;
+    lambda_.at(0) = one;
+    CTensor C = Q[L-1];
+    for (index k = L-1; k > 0; k--) {
+      index a, i, b;
+      C.get_dimensions(&a, &i, &b);
+      CTensor U, V;
+      RTensor s = linalg::block_svd(reshape(C, a, i*b), &U, &V, SVD_ECONOMIC);
+      index n = where_to_truncate(s, MPS_TRUNCATE_ZEROS, s.size());
+      if (n != s.size()) {
+        U = change_dimension(U, -1, n);
+        V = change_dimension(V, 0, n);
+        s = change_dimension(s, 0, n);
+      }
+      B_.at(k) = reshape(V, n, i, b);
+      lambda_.at(k) = s / norm2(s);
+      scale_inplace(U, -1, s);
+      C = fold(Q[k-1], -1, U, 0);
+    }
+    B_.at(0) = C / norm2(C);
+  }
+
+  /*
+   * Gate on the bond (k,k+1): with Theta = U (B_k B_{k+1}), the SVD of
+   * Lambda_k Theta = X S Y gives B_{k+1} = Y and Lambda_{k+1} = S, while
+   * B_k = Theta Y^+ is computed without dividing by Lambda_k. Only B_k,
+   * B_{k+1} and Lambda_{k+1} are written, and Lambda_k is just read, so
+   * that gates on bonds of the same parity are independent.
+   */
+  double
+  TEBDSolver::apply_gate(index k, index Dmax)
+  {
+    index a1, i1, a2, i2, a3;
+    B_[k].get_dimensions(&a1, &i1, &a2);
+    B_[k+1].get_dimensions(&a2, &i2, &a3);
+    CTensor Theta = reshape(fold(B_[k], -1, B_[k+1], 0), a1, i1*i2, a3);
+    Theta = reshape(foldin(U_[k], -1, Theta, 1), a1*i1, i2*a3);
+    CTensor Phi = reshape(Theta * to_complex(1.0), a1, i1*i2*a3);
+    scale_inplace(Phi, 0, lambda_[k]);
+
+    CTensor X, Y;
+    RTensor s = linalg::block_svd(reshape(Phi, a1*i1, i2*a3), &X, &Y,
+                                  SVD_ECONOMIC);
+    double n2 = square(norm2(s));
+    index b = where_to_truncate(s, tolerance, Dmax? Dmax : s.size());
+    if (b != s.size()) {
+      Y = change_dimension(Y, 0, b);
+      s = change_dimension(s, 0, b);
+    }
+    double n = norm2(s);
+    B_.at(k+1) = reshape(Y, b, i2, a3);
+    B_.at(k) = reshape(fold(Theta, 1, conj(Y), 1), a1, i1, b) / n;
+    lambda_.at(k+1) = s / n;
+    return (n2 - n*n) / n2;
+  }
+
+  double
+  TEBDSolver::apply_layer(int parity, index Dmax)
+  {
+    int L = B_.size();
+    std::vector<double> err(L, 0.0);
+#pragma omp parallel for schedule(dynamic)
+    for (int k = parity; k < L-1; k += 2) {
+      err.at(k) = apply_gate(k, Dmax);
+    }
+    double output = 0.0;
+    for (int k = 0; k < L; k++) {
+      output += err[k];
+    }
+    return output;
+  }
+
+  double
+  TEBDSolver::one_step(CMPS *P, index Dmax)
+  {
+    bool same = (P->size() == last_.size());
+    for (index k = 0; same && k < P->size(); k++) {
+      same = all_equal((*P)[k].dimensions(), last_[k].dimensions()) &&
+        all_equal((*P)[k], last_[k]);
+    }
+    if (!same) {
+      set_state(*P);
+    }
+    double err = apply_layer(0, Dmax);
+    err += apply_layer(1, Dmax);
+    err += apply_layer(0, Dmax);
+    for (index k = 0; k < B_.size(); k++) {
+      P->at(k) = B_[k];
+    }
+    last_ = *P;
+    return err;
+  }
+
+} // namespace mps
@@ -28,7 +28,7 @@ namespace mps {
    */
 
   Trotter3Solver::Trotter3Solver(const Hamiltonian &H, cdouble dt) :
-  TrotterSolver(dt), U1(H, 1, dt), U2(H, 0, dt/2.0), sense(0)
+  TrotterSolver(dt), U1(H, 1, dt), U2(H, 0, dt/2.0), U3(H, 0, dt), sense(0)
   {
   }
 
@@ -92,4 +92,38 @@ namespace mps {
     }
   }
 
+  /*
+   * Between consecutive steps the two exp(-iH_even dt/2) are merged into
+   * a single layer exp(-iH_even dt), so that n steps take 2n+1 layers
+   * instead of 3n.
+   */
+  double
+  Trotter3Solver::evolve(CMPS *P, index nsteps, index Dmax)
+  {
+    if (!Dmax) {
+      if (strategy != DO_NOT_TRUNCATE) {
+        std::cerr << "In TrotterSolver::evolve(), no maximum dimension provided\n";
+        abort();
+      }
+    }
+    if (nsteps == 0) {
+      return 0.0;
+    }
+    double tol = (strategy == TRUNCATE_EACH_UNITARY)?
+      MPS_DEFAULT_TOLERANCE : MPS_TRUNCATE_ZEROS;
+    double err = apply_layer(U2, P, &sense, tol, Dmax, false, false);
+    for (index n = 1; n <= nsteps; n++) {
+      err += apply_layer(U1, P, &sense, tol, Dmax, false, false);
+      if (n < nsteps) {
+        err += apply_layer(U3, P, &sense, tol, Dmax, true, false);
+      } else {
+        err += apply_layer(U2, P, &sense, tol, Dmax, true, normalize);
+      }
+    }
+    if (strategy == DO_NOT_TRUNCATE) {
+      return 0.0;
+    }
+    return err;
+  }
+
 } // namespace mps
@@ -36,6 +36,7 @@ namespace mps {
     U2(H, 1, dt*FR_param[1]),
     U3(H, 0, dt*FR_param[2]),
     U4(H, 1, dt*FR_param[3]),
+    U1x2(H, 0, dt*(2*FR_param[0])),
     sense(0)
   {
   }
@@ -125,4 +126,42 @@ namespace mps {
     }
   }
 
+  /*
+   * The first and last layers of a step are the same, and between
+   * consecutive steps they are merged, so that n steps take 6n+1 layers
+   * instead of 7n. Every other layer is truncated as in one_step(): in
+   * groups after layers 2, 5 and 7, and with TRUNCATE_EACH_LAYER, layers
+   * 6 and 7 are not limited in dimension. The merged layer is truncated
+   * whenever one of the two layers that it replaces is.
+   */
+  double
+  ForestRuthSolver::evolve(CMPS *P, index nsteps, index Dmax)
+  {
+    if (!Dmax) {
+      if (strategy != DO_NOT_TRUNCATE) {
+        std::cerr << "In TrotterSolver::evolve(), no maximum dimension provided\n";
+        abort();
+      }
+    }
+    if (nsteps == 0) {
+      return 0.0;
+    }
+    double tol = MPS_DEFAULT_TOLERANCE;
+    index Dlast = (strategy == TRUNCATE_EACH_LAYER)? 0 : Dmax;
+    double err = apply_layer(U1, P, &sense, tol, Dmax, false, false);
+    for (index n = 1; n <= nsteps; n++) {
+      err += apply_layer(U2, P, &sense, tol, Dmax, true, false);
+      err += apply_layer(U3, P, &sense, tol, Dmax, false, false);
+      err += apply_layer(U4, P, &sense, tol, Dmax, false, false);
+      err += apply_layer(U3, P, &sense, tol, Dmax, true, false);
+      err += apply_layer(U2, P, &sense, tol, Dlast, false, false);
+      if (n < nsteps) {
+        err += apply_layer(U1x2, P, &sense, tol, Dmax, true, false);
+      } else {
+        err += apply_layer(U1, P, &sense, tol, Dlast, true, normalize);
+      }
+    }
+    return err;
+  }
+
 } // namespace mps
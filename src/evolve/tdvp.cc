@@ -0,0 +1,246 @@
+// -*- mode: c++; fill-column: 80; c-basic-offset: 2; indent-tabs-mode: nil -*-
+/*
+    Copyright (c) 2010 Juan Jose Garcia Ripoll
+
+    Tensor is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published
+    by the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Library General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include <algorithm>
+#include <tensor/linalg.h>
+#include <mps/mps.h>
+#include <mps/qform.h>
+#include <mps/time_evolve.h>
+
+namespace mps {
+
+  /* Effective Hamiltonian of the TDVP sweeps around site here() of the
+     quadratic form. It acts on two sites, (k,k+1) or (k-1,k) depending on
+     'sense', on the single site k, or on the bond matrix C between the
+     orthonormal tensor Q = P[k] and its neighbour in the direction of
+     'sense'. In the last case the operator is Q^+ H1 Q, with H1 the
+     single-site operator at k. */
+  struct TDVPOperator {
+    TDVPOperator(const CQForm *qf, int sites, int sense,
+                 const Indices &dimensions, const CTensor &Q = CTensor()) :
+      qf_(qf), sites_(sites), sense_(sense), dimensions_(dimensions), Q_(Q)
+    {}
+
+    const CTensor operator()(const CTensor &x) const {
+      CTensor P = reshape(x, dimensions_);
+      if (sites_ == 2) {
+        return qf_->apply_two_site_matrix(P, sense_);
+      } else if (sites_ == 1) {
+        return qf_->apply_one_site_matrix(P);
+      }
+      index a, i, b;
+      Q_.get_dimensions(&a, &i, &b);
+      if (sense_ > 0) {
+        CTensor Y = qf_->apply_one_site_matrix(fold(Q_, -1, P, 0));
+        return foldc(reshape(Q_, a*i, b), 0, reshape(Y, a*i, Y.size()/(a*i)), 0);
+      } else {
+        CTensor Y = qf_->apply_one_site_matrix(fold(P, -1, Q_, 0));
+        return fold(reshape(Y, Y.size()/(i*b), i*b), 1, conj(reshape(Q_, a, i*b)), 1);
+      }
+    }
+
+    const CQForm *qf_;
+    int sites_, sense_;
+    Indices dimensions_;
+    CTensor Q_;
+  };
+
+  /* exp(z A) v for a Hermitian operator A, computed in a Lanczos basis with
+     full reorthogonalization. The basis grows until the last coefficient of
+     the exponential, times the norm of the residual, falls below 'tol', or
+     until it has 'max_states' vectors. */
+  static const CTensor
+  lanczos_expm(const TDVPOperator &A, const CTensor &v, cdouble z,
+               int max_states, double tol = 1e-12)
+  {
+    index n = v.size();
+    double beta0 = norm2(v);
+    if (beta0 == 0) {
+      return v;
+    }
+    std::vector<CTensor> V(1, reshape(v, n) / beta0);
+    CTensor T = CTensor::zeros(max_states, max_states);
+    CTensor coef;
+    for (int m = 0; m < max_states; m++) {
+      CTensor w = reshape(A(V[m]), n);
+      T.at(m,m) = real(scprod(V[m], w));
+      for (int pass = 0; pass < 2; pass++) {
+        for (int k = 0; k <= m; k++) {
+          w = w - scprod(V[k], w) * V[k];
+        }
+      }
+      double beta = norm2(w);
+      CTensor e0 = CTensor::zeros(igen << m+1);
+      e0.at(0) = to_complex(1.0);
+      coef = mmult(linalg::expm(z * T(range(0,m),range(0,m))), e0);
+      if (beta < tol || beta * tensor::abs(coef[m]) < tol || m+1 == max_states) {
+        break;
+      }
+      T.at(m,m+1) = T.at(m+1,m) = beta;
+      V.push_back(w / beta);
+    }
+    CTensor output = coef[0] * V[0];
+    for (index k = 1; k < coef.size(); k++) {
+      output += coef[k] * V[k];
+    }
+    return reshape(output * beta0, v.dimensions());
+  }
+
+  TDVPSolver::TDVPSolver(const Hamiltonian &H, cdouble dt, bool two_site,
+                         int nvectors) :
+    TimeSolver(dt), tolerance(MPS_TIME_EVOLVE_TOLERANCE), H_(H, 0.0),
+    two_site_(two_site), max_states_(nvectors), qform_(0)
+  {
+    if (max_states_ <= 0) {
+      std::cerr << "In TDVPSolver(...), the number of states must be positive"
+		<< std::endl;
+      abort();
+    }
+  }
+
+  TDVPSolver::TDVPSolver(const CMPO &H, cdouble dt, bool two_site,
+                         int nvectors) :
+    TimeSolver(dt), tolerance(MPS_TIME_EVOLVE_TOLERANCE), H_(H),
+    two_site_(two_site), max_states_(nvectors), qform_(0)
+  {
+    if (max_states_ <= 0) {
+      std::cerr << "In TDVPSolver(...), the number of states must be positive"
+		<< std::endl;
+      abort();
+    }
+  }
+
+  TDVPSolver::~TDVPSolver()
+  {
+    delete qform_;
+  }
+
+  /* True when P is the state that the last step produced, so that the
+     environments in qform_ still describe it. */
+  bool
+  TDVPSolver::same_state(const CMPS &P) const
+  {
+    if (P.size() != last_.size())
+      return false;
+    for (index k = 0; k < P.size(); k++) {
+      if (!all_equal(P[k].dimensions(), last_[k].dimensions()) ||
+          !all_equal(P[k], last_[k]))
+        return false;
+    }
+    return true;
+  }
+
+  /*
+   * Two-site sweep: each pair of sites evolves forward with exp(z H2) and
+   * is split with a truncated SVD, after which the tensor that carries the
+   * singular values evolves backward with exp(-z H1), except at the end of
+   * the sweep. The discarded weight is returned.
+   */
+  double
+  TDVPSolver::two_site_sweep(CMPS &P, cdouble z, int sense, index Dmax)
+  {
+    index L = P.size();
+    double err = 0;
+    for (index n = 1; n < L; n++) {
+      index k = (sense > 0)? n-1 : L-n;
+      index k1 = k, k2 = k+sense, knext = k+sense;
+      if (sense < 0) std::swap(k1, k2);
+      assert(qform_->here() == k);
+      CTensor P12 = fold(P[k1], -1, P[k2], 0);
+      TDVPOperator H2(qform_, 2, sense, P12.dimensions());
+      P12 = lanczos_expm(H2, P12, z, max_states_);
+      double n2 = square(norm2(P12));
+      set_canonical_2_sites(P, P12, k, sense, Dmax, tolerance, false);
+      err += std::max(0.0, n2 - square(norm2(P[knext])));
+      qform_->propagate(P[k], P[k], sense);
+      if (n+1 < L) {
+        TDVPOperator H1(qform_, 1, sense, P[knext].dimensions());
+        P.at(knext) = lanczos_expm(H1, P[knext], -z, max_states_);
+      }
+    }
+    return err;
+  }
+
+  /*
+   * One-site sweep: each site evolves forward with exp(z H1) and is split
+   * into an orthonormal tensor Q and a bond matrix C. The bond matrix
+   * evolves backward with the zero-site operator Q^+ H1 Q and is absorbed
+   * by the next site, except at the end of the sweep.
+   */
+  void
+  TDVPSolver::one_site_sweep(CMPS &P, cdouble z, int sense)
+  {
+    index L = P.size();
+    for (index n = 0; n < L; n++) {
+      index k = (sense > 0)? n : L-1-n;
+      assert(qform_->here() == k);
+      TDVPOperator H1(qform_, 1, sense, P[k].dimensions());
+      CTensor A = lanczos_expm(H1, P[k], z, max_states_);
+      if (n+1 == L) {
+        P.at(k) = A;
+        break;
+      }
+      index a, i, b;
+      A.get_dimensions(&a, &i, &b);
+      CTensor U, V, Q, C;
+      if (sense > 0) {
+        RTensor s = linalg::block_svd(reshape(A, a*i, b), &U, &V, SVD_ECONOMIC);
+        Q = reshape(U, a, i, s.size());
+        C = V;
+        scale_inplace(C, 0, s);
+      } else {
+        RTensor s = linalg::block_svd(reshape(A, a, i*b), &U, &V, SVD_ECONOMIC);
+        Q = reshape(V, s.size(), i, b);
+        C = U;
+        scale_inplace(C, -1, s);
+      }
+      TDVPOperator H0(qform_, 0, sense, C.dimensions(), Q);
+      C = lanczos_expm(H0, C, -z, max_states_);
+      P.at(k) = Q;
+      if (sense > 0) {
+        P.at(k+1) = fold(C, -1, P[k+1], 0);
+      } else {
+        P.at(k-1) = fold(P[k-1], -1, C, 0);
+      }
+      qform_->propagate(Q, Q, sense);
+    }
+  }
+
+  double
+  TDVPSolver::one_step(CMPS *P, index Dmax)
+  {
+    if (!qform_ || !same_state(*P)) {
+      delete qform_;
+      last_ = canonical_form(*P, -1);
+      qform_ = new CQForm(H_, last_, last_, 0);
+    }
+    cdouble z = to_complex(0.0, -0.5) * time_step();
+    double err = 0;
+    if (two_site_ && last_.size() > 1) {
+      err += two_site_sweep(last_, z, +1, Dmax);
+      err += two_site_sweep(last_, z, -1, Dmax);
+    } else {
+      one_site_sweep(last_, z, +1);
+      one_site_sweep(last_, z, -1);
+    }
+    *P = last_;
+    return err;
+  }
+
+} // namespace mps
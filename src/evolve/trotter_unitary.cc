@@ -112,9 +112,32 @@ namespace mps {
     P1.get_dimensions(&a1, &i1, &a2);
     CTensor P2 = P[k2];
     P2.get_dimensions(&a2, &i2, &a3);
+    index b1 = a1, b3 = a3;
 
     double err = 0.0;
 
+    /* Reduced update: when an outer bond is larger than the physical leg
+     * times the inner bond, P1 = X1 * R1 and P2 = R2 * X2 are split with
+     * isometries X1 and X2 that the unitary does not touch, and only the
+     * smaller core R1 * R2 is decomposed below. */
+    CTensor X1, X2;
+    if (a1 > i1 * a2) {
+      CTensor R1;
+      RTensor s = linalg::block_svd(reshape(P1, a1, i1*a2), &X1, &R1,
+                                    SVD_ECONOMIC);
+      scale_inplace(R1, 0, s);
+      a1 = s.size();
+      P1 = reshape(R1, a1, i1, a2);
+    }
+    if (a3 > i2 * a2) {
+      CTensor R2;
+      RTensor s = linalg::block_svd(reshape(P2, a2*i2, a3), &R2, &X2,
+                                    SVD_ECONOMIC);
+      scale_inplace(R2, -1, s);
+      a3 = s.size();
+      P2 = reshape(R2, a2, i2, a3);
+    }
+
     /* Apply the unitary onto two neighboring sites. This creates a
      * larger tensor that we have to split into two new tensors, Pout[k1]
      * and Pout[k2], that represent the sites */
@@ -122,8 +145,8 @@ namespace mps {
     if (!U12.is_empty()) {
       P1 = foldin(U12, -1, P1, 1);
     }
-    RTensor s = linalg::svd(reshape(P1,a1*i1,i2*a3), &P1, &P2,
-                            SVD_ECONOMIC);
+    RTensor s = linalg::block_svd(reshape(P1,a1*i1,i2*a3), &P1, &P2,
+                                  SVD_ECONOMIC);
     if (dk > 0) {
       scale_inplace(P2, 0, s);
     } else {
@@ -138,16 +161,22 @@ namespace mps {
       for (index i = a2; i < s.size(); i++)
         err += square(s[i]);
     }
+    if (!X1.is_empty()) {
+      P1 = mmult(X1, reshape(P1, a1, i1*a2));
+    }
+    if (!X2.is_empty()) {
+      P2 = mmult(reshape(P2, a2*i2, a3), X2);
+    }
     if (max_a2) {
       /* If we impose a truncation at this stage, we are using
        * Guifre's original TEBD algorithm and we split and
        * orthogonalize as we move on. */
       if (dk > 0) {
-        P.at(k1) = reshape(P1, a1,i1,a2);
-        set_canonical(P, k2, reshape(P2, a2,i2,a3), dk);
+        P.at(k1) = reshape(P1, b1,i1,a2);
+        set_canonical(P, k2, reshape(P2, a2,i2,b3), dk);
       } else {
-        P.at(k2) = reshape(P2, a2,i2,a3);
-        set_canonical(P, k1, reshape(P1, a1,i1,a2), dk);
+        P.at(k2) = reshape(P2, a2,i2,b3);
+        set_canonical(P, k1, reshape(P1, b1,i1,a2), dk);
       }
     } else {
       /*
@@ -155,8 +184,8 @@ namespace mps {
        * values) and we just keep the result of applying the
        * unitaries. Truncation will be done at a later stage.
        */
-      P.at(k1) = reshape(P1, a1,i1,a2);
-      P.at(k2) = reshape(P2, a2,i2,a3);
+      P.at(k1) = reshape(P1, b1,i1,a2);
+      P.at(k2) = reshape(P2, a2,i2,b3);
     }
     return err;
   }
@@ -20,24 +20,20 @@
 #include <cassert>
 #include <mps/mpo.h>
 #include <mps/io.h>
+#include "mpo_from_hamiltonian.cc"
 
 namespace mps {
 
+  static const CTensor same_tensor(const CTensor &R)
+  {
+    return R;
+  }
+
   CMPO::CMPO(const Hamiltonian &H, double t) :
     parent(H.size())
   {
-    clear(H.dimensions());
-    for (index i = 0; i < size(); i++) {
-      add_local_term(this, H.local_term(i,t), i);
-    }
-    for (index i = 0; i < (size()-1); i++) {
-      for (index j = 0; j < H.interaction_depth(i, t); j++) {
-        CTensor Hi = H.interaction_left(i, j, t);
-        CTensor Hj = H.interaction_right(i, j, t);
-        if (!Hi.is_empty())
-          add_interaction(this, Hi, i, Hj);
-      }
-    }
+    fill_from_hamiltonian(*this, H, t, same_tensor);
+    *this = compress(*this, 0);
   }
 
 } // namespace mps
@@ -0,0 +1,76 @@
+// -*- mode: c++; fill-column: 80; c-basic-offset: 2; indent-tabs-mode: nil -*-
+/*
+    Copyright (c) 2010 Juan Jose Garcia Ripoll
+
+    Tensor is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published
+    by the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Library General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include <mps/mpo.h>
+
+namespace mps {
+
+  /* The sum shares the channels 0 and 1 of both operators, and the
+     identities that connect them are only taken once. The inner channels
+     of B are placed after those of A on every bond, and compress() then
+     merges those that are parallel. */
+  template<class MPO>
+  static const MPO do_add(const MPO &A, const MPO &B, double tol)
+  {
+    typedef typename MPO::elt_t Tensor;
+    if (A.size() != B.size()) {
+      std::cerr << "In add(MPO, MPO), the operators have different sizes.\n";
+      abort();
+    }
+    index L = A.size();
+    MPO C = A;
+    if (L == 1) {
+      C.at(0) = A[0] + B[0];
+      return C;
+    }
+    for (index k = 0; k < L; k++) {
+      index al, d1, d2, ar, bl, br;
+      A[k].get_dimensions(&al, &d1, &d2, &ar);
+      bl = B[k].dimension(0);
+      br = B[k].dimension(3);
+      if (B[k].dimension(1) != d1 || B[k].dimension(2) != d2) {
+        std::cerr << "In add(MPO, MPO), the operators have different "
+          "dimensions on site " << k << ".\n";
+        abort();
+      }
+      index cl = (k == 0)? 1 : al + bl - 2;
+      index cr = (k+1 == L)? 1 : ar + br - 2;
+      Tensor P = Tensor::zeros(cl, d1, d2, cr);
+      P.at(range(0, al-1), range(), range(), range(0, ar-1)) = A[k];
+      for (index b1 = 0; b1 < bl; b1++) {
+        /* Channel of the bond, and its position in the sum */
+        index c1 = (k == 0)? 0 : b1;
+        index n1 = (c1 < 2)? c1 : al + b1 - 2;
+        for (index b2 = 0; b2 < br; b2++) {
+          index c2 = (k+1 == L)? 1 : b2;
+          index n2 = (k+1 == L)? 0 : ((c2 < 2)? c2 : ar + b2 - 2);
+          if (c1 == c2 && c1 < 2) {
+            continue;
+          }
+          P.at(range(n1), range(), range(), range(n2)) =
+            Tensor(P(range(n1), range(), range(), range(n2))) +
+            Tensor(B[k](range(b1), range(), range(), range(b2)));
+        }
+      }
+      C.at(k) = P;
+    }
+    return compress(C, tol);
+  }
+
+} // namespace mps
@@ -0,0 +1,158 @@
+// -*- mode: c++; fill-column: 80; c-basic-offset: 2; indent-tabs-mode: nil -*-
+/*
+    Copyright (c) 2010 Juan Jose Garcia Ripoll
+
+    Tensor is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published
+    by the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Library General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include <cmath>
+#include <algorithm>
+#include <tensor/linalg.h>
+#include <mps/mpo.h>
+#include <mps/tools.h>
+
+namespace mps {
+
+  /* Approximate J(r) = J[r-1], r = 1..N, as J(r) = w' * A^(r-1) * v, with a
+     square matrix A of size K. This is a sum of K exponentials, written in a
+     basis in which A may not be diagonal, so that oscillating terms remain
+     real. A, v, w are obtained from the SVD of the Hankel matrix
+     H(i,j) = J(i+j+1) = O(i,:) * C(:,j), using that the rows of O satisfy
+     O(i+1,:) = O(i,:) * A. The function returns the largest error of the
+     fit. */
+  static double
+  fit_exponentials(const RTensor &J, double tol, index Kmax,
+                   RTensor *A, RTensor *v, RTensor *w)
+  {
+    index N = J.size();
+    index n1 = N/2 + 1, n2 = N + 1 - n1;
+    RTensor H(n1, n2);
+    for (index i = 0; i < n1; i++) {
+      for (index j = 0; j < n2; j++) {
+        H.at(i,j) = J[i+j];
+      }
+    }
+    RTensor U, V;
+    RTensor s = linalg::svd(H, &U, &V, SVD_ECONOMIC);
+    index K = where_to_truncate(s, tol, Kmax);
+    if (K == 0) {
+      *A = *v = *w = RTensor();
+      return 0.0;
+    }
+    s = change_dimension(s, 0, K);
+    for (index k = 0; k < K; k++) {
+      s.at(k) = std::sqrt(s[k]);
+    }
+    U = change_dimension(U, 1, K);
+    V = change_dimension(V, 0, K);
+    scale_inplace(U, 1, s);
+    scale_inplace(V, 0, s);
+    *w = reshape(RTensor(U(range(0), range())), K);
+    *v = reshape(RTensor(V(range(), range(0))), K);
+    if (n1 == 1) {
+      *A = RTensor::zeros(K, K);
+    } else {
+      /* A = pinv(O1) * O2, with O1 and O2 the first and last n1-1 rows */
+      RTensor O1 = U(range(0, n1-2), range());
+      RTensor O2 = U(range(1, n1-1), range());
+      RTensor Uo, Vo;
+      RTensor so = linalg::svd(O1, &Uo, &Vo, SVD_ECONOMIC);
+      index r = where_to_truncate(so, 1e-14, 0);
+      Uo = change_dimension(Uo, 1, r);
+      Vo = change_dimension(Vo, 0, r);
+      RTensor aux = mmult(transpose(Uo), O2);
+      for (index k = 0; k < r; k++) {
+        so.at(k) = 1.0 / so[k];
+      }
+      scale_inplace(aux, 0, change_dimension(so, 0, r));
+      *A = mmult(transpose(Vo), aux);
+    }
+    double error = 0;
+    RTensor x = *v;
+    for (index r = 1; r <= N; r++) {
+      error = std::max(error, std::abs(scprod(*w, x) - J[r-1]));
+      x = mmult(*A, x);
+    }
+    return error;
+  }
+
+  template<class MPO, class Tensor>
+  static double
+  do_add_long_range_interaction(MPO &mpo, const Tensor &Hi, const Tensor &Hj,
+                                const RTensor &J, double tol, index Kmax)
+  {
+    index L = mpo.size();
+    if (J.size() + 1 < L) {
+      std::cerr << "In add_long_range_interaction(), the coupling vector has "
+        "less than " << L-1 << " distances.\n";
+      abort();
+    }
+    if (Hi.rows() != Hi.columns() || Hj.rows() != Hj.columns()) {
+      std::cerr << "In add_long_range_interaction(), the operators are not "
+        "square matrices.\n";
+      abort();
+    }
+    if (L < 2) {
+      return 0.0;
+    }
+    RTensor A, v, w;
+    double error = fit_exponentials(RTensor(J(range(0, L-2))), tol, Kmax, &A, &v, &w);
+    index K = v.size();
+    if (K == 0) {
+      return error;
+    }
+    /* Channels K are appended to every bond. A term opens with v*Hi from
+       channel 0, is propagated by A*Id, and is closed with w*Hj into
+       channel 1 (or 0, on the last site). */
+    for (index j = 0; j < L; j++) {
+      Tensor Pj = mpo[j];
+      index d = Pj.dimension(1);
+      if (Hi.rows() != d || Hj.rows() != d) {
+        std::cerr << "In add_long_range_interaction(), the operators do not "
+          "match the MPO dimensions.\n";
+        abort();
+      }
+      index dl = Pj.dimension(0);
+      index dr = Pj.dimension(3);
+      if (j > 0) {
+        Pj = change_dimension(Pj, 0, dl + K);
+      }
+      if (j+1 < L) {
+        Pj = change_dimension(Pj, 3, dr + K);
+      }
+      Tensor Id = Tensor::eye(d);
+      for (index k = 0; k < K; k++) {
+        if (j+1 < L) {
+          Pj.at(range(0), range(), range(), range(dr+k)) =
+            reshape(v[k] * Hi, 1, d, d, 1);
+        }
+        if (j > 0) {
+          index closing = (j+1 < L)? 1 : 0;
+          Pj.at(range(dl+k), range(), range(), range(closing)) =
+            reshape(w[k] * Hj, 1, d, d, 1);
+        }
+        if (j > 0 && j+1 < L) {
+          for (index l = 0; l < K; l++) {
+            Pj.at(range(dl+k), range(), range(), range(dr+l)) =
+              reshape(A(l,k) * Id, 1, d, d, 1);
+          }
+        }
+      }
+      mpo.at(j) = Pj;
+    }
+    return error;
+  }
+
+} // namespace mps
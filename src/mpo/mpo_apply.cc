@@ -17,31 +17,100 @@
     51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
 */
 
-#include <mps/mpo.h>
+#include <mps/sparse_mpo.h>
+#include <tensor/io.h>
 
 namespace mps {
 
-  template<class MPS, class MPO>
-  static const MPS do_apply(const MPO &mpdo, const MPS &psi)
+  template<class MPS, class Tensor>
+  static const MPS do_apply(const SparseMPO<Tensor> &mpo, const MPS &psi)
   {
-    typedef typename MPS::elt_t Tensor;
-    assert(mpdo.size() == psi.size());
+    typedef typename SparseMPO<Tensor>::Site Site;
+    assert(mpo.size() == psi.size());
 
-    index a1, c1, j, c2, a2;
-    index L = mpdo.size();
+    index a1, i, a2;
+    index L = mpo.size();
     MPS chi(psi.size());
 
-    for (index i = 0; i < L; i++) {
-      const Tensor &A = psi[i]; /* A(a1,i,a2) */
-      const Tensor &O = mpdo[i]; /* O(c1,j,i,c2) */
-      
-      /* B(a1,c1,j,c2,a2) = O(c1,j,i,c2) A(a1,i,a2) */
-      Tensor B = foldin(O, 2, A, 1);
-      B.get_dimensions(&a1, &c1, &j, &c2, &a2);
+    for (index k = 0; k < L; k++) {
+      const Tensor &A = psi[k]; /* A(a1,i,a2) */
+      const Site &s = mpo[k]; /* O(c1,j,i,c2) */
+      A.get_dimensions(&a1, &i, &a2);
 
-      chi.at(i) = reshape(permute(B, 3, 4), a1*c1, j, a2*c2);
+      /* B([a1,c1],j,[a2,c2]) = O(c1,j,i,c2) A(a1,i,a2), built block by
+         block, copying A for the identities. Several operators of the
+         site may share the same pair of channels, so that the blocks are
+         accumulated as in dense(). */
+      index c1 = s.left_dimension(), c2 = s.right_dimension();
+      Tensor B = Tensor::zeros(a1*c1, s.d1, a2*c2);
+      for (index n = 0; n < s.size(); n++) {
+        index l = s.left_ndx[n] * a1, r = s.right_ndx[n] * a2;
+        Tensor OA = s.identity[n]? A : foldin(s.op[n], -1, A, 1);
+        B.at(range(l, l+a1-1), range(), range(r, r+a2-1)) =
+          Tensor(B(range(l, l+a1-1), range(), range(r, r+a2-1))) + OA;
+      }
+      chi.at(k) = B;
     }
     return chi;
   }
 
+  /* Apply the MPO onto a state vector without building its matrix. The
+     vector is kept split into the channels of the MPO bond on the left of
+     the current site, X[a](l,j,r), with 'l' the outputs of the sites
+     already processed and 'r' the inputs of the remaining ones. Site 0 is
+     the fastest index, as in mpo_to_matrix(). Each step costs
+     O(d^L D_in D_out / d) operations and the channels of the output are
+     computed in parallel. */
+  template<class Tensor>
+  static const Tensor do_apply(const SparseMPO<Tensor> &mpo, const Tensor &v)
+  {
+    typedef typename SparseMPO<Tensor>::Site Site;
+    typedef typename Tensor::elt_t number;
+    index L = mpo.size();
+    index left = 1, right = 1;
+    for (index k = 0; k < L; k++) {
+      right *= mpo[k].d2;
+    }
+    if (v.size() != right) {
+      std::cerr << "In apply(MPO, Tensor), the vector size " << v.size()
+                << " does not match the MPO dimension " << right << '\n';
+      abort();
+    }
+
+    std::vector<Tensor> X(1, v);
+    for (index k = 0; k < L; k++) {
+      const Site &s = mpo[k];
+      right /= s.d2;
+      assert(X.size() == s.left_dimension());
+      for (index a = 0; a < X.size(); a++) {
+        if (!X[a].is_empty())
+          X.at(a) = reshape(X[a], left, s.d2, right);
+      }
+      index nb = s.right_dimension();
+      std::vector<Tensor> Y(nb);
+#pragma omp parallel for schedule(dynamic)
+      for (index b = 0; b < nb; b++) {
+        Tensor Yb;
+        for (index m = s.right_start[b]; m < s.right_start[b+1]; m++) {
+          index n = s.by_right[m];
+          const Tensor &Xa = X[s.left_ndx[n]];
+          if (Xa.is_empty())
+            continue;
+          /* Y[b](l,i,r) += O(i,j) X[a](l,j,r) */
+          Tensor Z = s.identity[n]? Xa * number(1.0) : foldin(s.op[n], -1, Xa, 1);
+          if (Yb.is_empty())
+            Yb = Z;
+          else
+            Yb += Z;
+        }
+        Y.at(b) = Yb;
+      }
+      X.swap(Y);
+      left *= s.d1;
+    }
+    if (X[0].is_empty())
+      return Tensor::zeros(left);
+    return reshape(X[0], left);
+  }
+
 } // namespace mps
@@ -23,7 +23,17 @@ namespace mps {
 
   const RMPS apply(const RMPO &mpdo, const RMPS &psi)
   {
-    return do_apply(mpdo, psi);
+    return do_apply(RSparseMPO(mpdo), psi);
+  }
+
+  const RMPS apply(const RSparseMPO &mpo, const RMPS &psi)
+  {
+    return do_apply(mpo, psi);
+  }
+
+  const RTensor apply(const RMPO &mpo, const RTensor &v)
+  {
+    return do_apply(RSparseMPO(mpo), v);
   }
 
 } // namespace mps
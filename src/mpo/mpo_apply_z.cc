@@ -23,7 +23,17 @@ namespace mps {
 
   const CMPS apply(const CMPO &mpdo, const CMPS &psi)
   {
-    return do_apply(mpdo, psi);
+    return do_apply(CSparseMPO(mpdo), psi);
+  }
+
+  const CMPS apply(const CSparseMPO &mpo, const CMPS &psi)
+  {
+    return do_apply(mpo, psi);
+  }
+
+  const CTensor apply(const CMPO &mpo, const CTensor &v)
+  {
+    return do_apply(CSparseMPO(mpo), v);
   }
 
 } // namespace mps
@@ -0,0 +1,210 @@
+// -*- mode: c++; fill-column: 80; c-basic-offset: 2; indent-tabs-mode: nil -*-
+/*
+    Copyright (c) 2010 Juan Jose Garcia Ripoll
+
+    Tensor is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published
+    by the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Library General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include <vector>
+#include <algorithm>
+#include <tensor/linalg.h>
+#include <mps/mpo.h>
+#include <mps/tools.h>
+
+namespace mps {
+
+  /* The bond between sites k and k+1 is written as a product of two matrices,
+     X(a*i*j,b) = W[k](a,i,j,b) and Y(b,i*j*c) = W[k+1](b,i,j,c). The first two
+     channels (0 = nothing applied yet, 1 = all terms done) are never touched,
+     so that the compressed MPO still admits add_local_term() and
+     add_interaction(). */
+
+  template<class Tensor>
+  static bool
+  remove_parallel_columns(Tensor *pX, Tensor *pY, index p)
+  {
+    typedef typename Tensor::elt_t number;
+    Tensor &X = *pX, &Y = *pY;
+    index b = X.columns();
+    std::vector<index> kept;
+    for (index c = 0; c < b; c++) {
+      if (c < p) {
+        kept.push_back(c);
+        continue;
+      }
+      Tensor col = X(range(), range(c));
+      double nc = norm2(col);
+      if (nc == 0) {
+        /* Channel that is never opened: drop it */
+        continue;
+      }
+      bool merged = false;
+      for (index n = 0; n < kept.size(); n++) {
+        index m = kept[n];
+        /* Merging into channels 0 or 1 would add operators to rows
+           that must only carry identities. */
+        if (m < p)
+          continue;
+        Tensor other = X(range(), range(m));
+        double no = norm2(other);
+        if (no == 0)
+          continue;
+        /* X(:,c) = lambda X(:,m)  =>  Y(m,:) += lambda Y(c,:) */
+        number lambda = scprod(other, col) / number(no * no);
+        if (norm2(col - lambda * other) <= 1e-13 * nc) {
+          Y.at(range(m), range()) =
+            Tensor(Y(range(m), range())) + lambda * Tensor(Y(range(c), range()));
+          merged = true;
+          break;
+        }
+      }
+      if (!merged) {
+        kept.push_back(c);
+      }
+    }
+    if (kept.size() == b) {
+      return false;
+    }
+    Indices ndx(kept.size());
+    for (index n = 0; n < kept.size(); n++) {
+      ndx.at(n) = kept[n];
+    }
+    X = Tensor(X(range(), range(ndx)));
+    Y = Tensor(Y(range(ndx), range()));
+    return true;
+  }
+
+  template<class MPO>
+  static bool
+  deparallelize_bond(MPO &mpo, index k, int sense)
+  {
+    typedef typename MPO::elt_t Tensor;
+    index a, i1, j1, b, i2, j2, c;
+    mpo[k].get_dimensions(&a, &i1, &j1, &b);
+    mpo[k+1].get_dimensions(&b, &i2, &j2, &c);
+    Tensor X = reshape(mpo[k], a*i1*j1, b);
+    Tensor Y = reshape(mpo[k+1], b, i2*j2*c);
+    index p = std::min<index>(b, 2);
+    bool changed;
+    if (sense > 0) {
+      changed = remove_parallel_columns(&X, &Y, p);
+    } else {
+      /* Parallel rows of Y are parallel columns of its transpose */
+      Tensor Xt = transpose(Y), Yt = transpose(X);
+      changed = remove_parallel_columns(&Xt, &Yt, p);
+      X = transpose(Yt);
+      Y = transpose(Xt);
+    }
+    if (changed) {
+      b = X.columns();
+      mpo.at(k) = reshape(X, a, i1, j1, b);
+      mpo.at(k+1) = reshape(Y, b, i2, j2, c);
+    }
+    return changed;
+  }
+
+  /* Replace the channels p.. of the bond k with the matrices Xm and Ym,
+     obtained from a singular value decomposition of the same block. The
+     block is not orthogonal to channels 0 and 1, so that truncating it is
+     not optimal and its error is not controlled by 'tol'. */
+  template<class MPO>
+  static void
+  svd_bond(MPO &mpo, index k, int sense, double tol)
+  {
+    typedef typename MPO::elt_t Tensor;
+    index a, i1, j1, b, i2, j2, c;
+    mpo[k].get_dimensions(&a, &i1, &j1, &b);
+    mpo[k+1].get_dimensions(&b, &i2, &j2, &c);
+    index p = std::min<index>(b, 2);
+    if (b <= p) {
+      return;
+    }
+    Tensor X = reshape(mpo[k], a*i1*j1, b);
+    Tensor Y = reshape(mpo[k+1], b, i2*j2*c);
+    Tensor Xm = X(range(), range(p, b-1));
+    Tensor Ym = Y(range(p, b-1), range());
+    Tensor U, V;
+    index r;
+    if (sense > 0) {
+      /* Xm = U s V, with U an isometry; s V is absorbed into Ym */
+      RTensor s = linalg::svd(Xm, &U, &V, SVD_ECONOMIC);
+      r = where_to_truncate(s, 0, 0);
+      if (r) {
+        U = change_dimension(U, 1, r);
+        V = change_dimension(V, 0, r);
+        scale_inplace(V, 0, change_dimension(s, 0, r));
+        Xm = U;
+        Ym = mmult(V, Ym);
+      }
+    } else {
+      /* Ym = U s V, truncated, with V an isometry; U s is absorbed into Xm */
+      RTensor s = linalg::svd(Ym, &U, &V, SVD_ECONOMIC);
+      r = where_to_truncate(s, tol, 0);
+      if (r) {
+        U = change_dimension(U, 1, r);
+        V = change_dimension(V, 0, r);
+        scale_inplace(U, 1, change_dimension(s, 0, r));
+        Xm = mmult(Xm, U);
+        Ym = V;
+      }
+    }
+    Tensor newX = Tensor::zeros(a*i1*j1, p + r);
+    Tensor newY = Tensor::zeros(p + r, i2*j2*c);
+    newX.at(range(), range(0, p-1)) = Tensor(X(range(), range(0, p-1)));
+    newY.at(range(0, p-1), range()) = Tensor(Y(range(0, p-1), range()));
+    if (r) {
+      newX.at(range(), range(p, p+r-1)) = Xm;
+      newY.at(range(p, p+r-1), range()) = Ym;
+    }
+    mpo.at(k) = reshape(newX, a, i1, j1, p + r);
+    mpo.at(k+1) = reshape(newY, p + r, i2, j2, c);
+  }
+
+  template<class MPO>
+  static const MPO
+  do_compress(const MPO &mpo, double tol)
+  {
+    MPO output = mpo;
+    index L = output.size();
+    if (L < 2) {
+      return output;
+    }
+    /* Exact deparallelization: channels that are created with the same
+       operator, or that end with the same operator, are merged. Merging
+       columns may create parallel rows and vice versa, hence the loop. */
+    bool changed;
+    do {
+      changed = false;
+      for (index k = 0; k+1 < L; k++) {
+        changed = deparallelize_bond(output, k, +1) || changed;
+      }
+      for (index k = L-1; k--; ) {
+        changed = deparallelize_bond(output, k, -1) || changed;
+      }
+    } while (changed);
+    if (tol > 0) {
+      /* Bring the inner channels to left-canonical form, then truncate them
+         from right to left. */
+      for (index k = 0; k+1 < L; k++) {
+        svd_bond(output, k, +1, 0.0);
+      }
+      for (index k = L-1; k--; ) {
+        svd_bond(output, k, -1, tol);
+      }
+    }
+    return output;
+  }
+
+} // namespace mps
@@ -17,7 +17,7 @@
     51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
 */
 
-#include <mps/mpo.h>
+#include <mps/sparse_mpo.h>
 
 namespace mps {
 
@@ -31,4 +31,9 @@ namespace mps {
     return expected(psi, op, psi);
   }
 
+  cdouble expected(const CMPS &bra, const CSparseMPO &op, const CMPS &ket)
+  {
+    return scprod(bra, apply(op, ket));
+  }
+
 } // namespace mps
@@ -0,0 +1,148 @@
+// -*- mode: c++; fill-column: 80; c-basic-offset: 2; indent-tabs-mode: nil -*-
+/*
+    Copyright (c) 2010 Juan Jose Garcia Ripoll
+
+    Tensor is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published
+    by the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Library General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include <cmath>
+#include <tensor/linalg.h>
+#include <mps/mpo.h>
+#include <mps/sparse_mpo.h>
+
+namespace mps {
+
+  template<class Tensor>
+  static void add_block(Tensor &X, const Tensor &O)
+  {
+    if (X.is_empty())
+      X = O;
+    else
+      X = X + O;
+  }
+
+  template<class Tensor>
+  static void set_block(Tensor &M, index out, index in, const Tensor &O)
+  {
+    index d = O.rows();
+    M.at(range(out*d, out*d+d-1), range(in*d, in*d+d-1)) = O;
+  }
+
+  /*
+   * With channel 0 open and channel 1 done, every site of H reads
+   *	W = [Id, C, D; 0, A, B; 0, 0, Id]
+   * where C opens the inner channels, B closes them and D is the local
+   * term. Dropping the done channel, exp(tau H) is approximated by
+   *	W^I = [exp(tau D), sqrt(tau) C; sqrt(tau) B, A]
+   * or, in the W^II construction, by the matrix elements of the exponential
+   * of tau D + sqrt(tau) (C_b f_b^+ + B_a f_a) + A_ab f_a f_b^+, where f_a
+   * and f_b are hard-core bosons that carry the incoming channel a and the
+   * outgoing channel b. Both are exact for local terms and have errors
+   * O(tau^2) per step. See Zaletel et al., PRB 91, 165112 (2015).
+   */
+  template<class MPO>
+  static const MPO
+  do_exponential_mpo(const MPO &H, typename MPO::elt_t::elt_t tau, int method)
+  {
+    typedef typename MPO::elt_t Tensor;
+    typedef typename Tensor::elt_t number;
+    typedef typename SparseMPO<Tensor>::Site Site;
+    if (method != 1 && method != 2) {
+      std::cerr << "In exponential_mpo(), the method " << method
+                << " is neither 1 (W^I) nor 2 (W^II).\n";
+      abort();
+    }
+    SparseMPO<Tensor> sH(H);
+    index L = H.size();
+    /* Split tau between the operators that open and close a channel. */
+    double sC = sqrt(tensor::abs(tau));
+    number sB = (sC == 0)? number(0.0) : tau / sC;
+
+    MPO output = H;
+    for (index k = 0; k < L; k++) {
+      const Site &s = sH[k];
+      index d = s.d1;
+      index aL = (k == 0)? 1 : s.left_dimension() - 1;
+      index aR = (k+1 == L)? 1 : s.right_dimension() - 1;
+      Tensor D = Tensor::zeros(d, d);
+      std::vector<Tensor> B(aL), C(aR), A(aL * aR);
+      for (index n = 0; n < s.size(); n++) {
+        index l = (k == 0)? 0 : s.left_ndx[n];
+        index r = (k+1 == L)? 1 : s.right_ndx[n];
+        const Tensor &O = s.op[n];
+        if (l == r && l < 2 && s.identity[n]) {
+          continue;
+        } else if (l == 0 && r == 1) {
+          D = D + O;
+        } else if (l == 0 && r > 1) {
+          add_block(C.at(r-1), O);
+        } else if (l > 1 && r == 1) {
+          add_block(B.at(l-1), O);
+        } else if (l > 1 && r > 1) {
+          add_block(A.at((l-1) + aL * (r-1)), O);
+        } else {
+          std::cerr << "In exponential_mpo(), site " << k << " does not have"
+                    << " the layout of add_local_term().\n";
+          abort();
+        }
+      }
+
+      Tensor W = Tensor::zeros(aL, d, d, aR);
+      for (index a = 0; a < aL; a++) {
+        for (index b = 0; b < aR; b++) {
+          const Tensor &Aab = A[a + aL * b];
+          Tensor O;
+          if (method == 1) {
+            if (a == 0 && b == 0)
+              O = linalg::expm(Tensor(tau * D));
+            else if (a == 0)
+              O = C[b].is_empty()? C[b] : sC * C[b];
+            else if (b == 0)
+              O = B[a].is_empty()? B[a] : sB * B[a];
+            else
+              O = Aab;
+          } else {
+            /* Boson states |f_a,f_b>: 0 = |0,0>, 1 = |1,0>, 2 = |0,1>
+               and 3 = |1,1>. */
+            Tensor M = Tensor::zeros(4*d, 4*d);
+            for (index n = 0; n < 4; n++) {
+              set_block(M, n, n, Tensor(tau * D));
+            }
+            if (b > 0 && !C[b].is_empty()) {
+              set_block(M, 2, 0, Tensor(sC * C[b]));
+              set_block(M, 3, 1, Tensor(sC * C[b]));
+            }
+            if (a > 0 && !B[a].is_empty()) {
+              set_block(M, 0, 1, Tensor(sB * B[a]));
+              set_block(M, 2, 3, Tensor(sB * B[a]));
+            }
+            if (a > 0 && b > 0 && !Aab.is_empty()) {
+              set_block(M, 2, 1, Aab);
+            }
+            index in = (a == 0)? 0 : 1, out = (b == 0)? 0 : 2;
+            Tensor E = linalg::expm(M);
+            O = Tensor(E(range(out*d, out*d+d-1), range(in*d, in*d+d-1)));
+          }
+          if (!O.is_empty()) {
+            W.at(range(a), range(), range(), range(b)) = reshape(O, 1, d, d, 1);
+          }
+        }
+      }
+      output.at(k) = W;
+    }
+    return output;
+  }
+
+} // namespace mps
@@ -0,0 +1,96 @@
+// -*- mode: c++; fill-column: 80; c-basic-offset: 2; indent-tabs-mode: nil -*-
+/*
+    Copyright (c) 2010 Juan Jose Garcia Ripoll
+
+    Tensor is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published
+    by the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Library General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include <vector>
+#include <mps/mpo.h>
+#include <mps/hamiltonian.h>
+
+namespace mps {
+
+  /* The MPO of a Hamiltonian with nearest-neighbor interactions is built as a
+     finite-state automaton. On every bond, channel 0 means that no operator
+     has been applied yet, channel 1 that the term is complete, and channel
+     2+n that the n-th interaction across that bond has been opened and has
+     to be closed on the next site. All terms are gathered first, so that the
+     tensors are allocated and written only once. */
+  template<class MPO, class Tensor>
+  static void
+  fill_from_hamiltonian(MPO &mpo, const Hamiltonian &H, double t,
+                        const Tensor (*convert)(const CTensor &))
+  {
+    index L = mpo.size();
+    if (L < 2) {
+      std::cerr << "Cannot create MPO with size 0 or 1.\n";
+      abort();
+    }
+    std::vector<std::vector<Tensor> > left(L), right(L);
+    for (index i = 0; i+1 < L; i++) {
+      for (index n = 0; n < H.interaction_depth(i, t); n++) {
+        Tensor Hi = convert(H.interaction_left(i, n, t));
+        if (!Hi.is_empty()) {
+          left.at(i).push_back(Hi);
+          right.at(i).push_back(convert(H.interaction_right(i, n, t)));
+        }
+      }
+    }
+    for (index k = 0; k < L; k++) {
+      index d = H.dimension(k);
+      index dl = (k == 0)? 1 : 2 + left[k-1].size();
+      index dr = (k+1 == L)? 1 : 2 + left[k].size();
+      index done = (k+1 == L)? 0 : 1;
+      Tensor P = Tensor::zeros(dl, d, d, dr);
+      Tensor Id = reshape(Tensor::eye(d,d), 1,d,d,1);
+      if (k+1 < L) {
+        P.at(range(0),range(),range(),range(0)) = Id;
+        for (index n = 0; n < left[k].size(); n++) {
+          const Tensor &Hi = left[k][n];
+          if (Hi.rows() != d || Hi.columns() != d) {
+            std::cerr << "In MPO(const Hamiltonian &), interaction " << n
+                      << " on site " << k << " has wrong dimensions.\n";
+            abort();
+          }
+          P.at(range(0),range(),range(),range(2+n)) = reshape(Hi, 1,d,d,1);
+        }
+      }
+      if (k > 0) {
+        P.at(range(1),range(),range(),range(done)) = Id;
+        for (index n = 0; n < right[k-1].size(); n++) {
+          const Tensor &Hj = right[k-1][n];
+          if (Hj.rows() != d || Hj.columns() != d) {
+            std::cerr << "In MPO(const Hamiltonian &), interaction " << n
+                      << " on site " << k-1 << " has wrong dimensions.\n";
+            abort();
+          }
+          P.at(range(2+n),range(),range(),range(done)) = reshape(Hj, 1,d,d,1);
+        }
+      }
+      Tensor Hloc = convert(H.local_term(k, t));
+      if (!Hloc.is_empty()) {
+        if (Hloc.rows() != d || Hloc.columns() != d) {
+          std::cerr << "In MPO(const Hamiltonian &), the local term on site "
+                    << k << " has wrong dimensions.\n";
+          abort();
+        }
+        P.at(range(0),range(),range(),range(done)) = reshape(Hloc, 1,d,d,1);
+      }
+      mpo.at(k) = P;
+    }
+  }
+
+} // namespace mps
@@ -0,0 +1,65 @@
+// -*- mode: c++; fill-column: 80; c-basic-offset: 2; indent-tabs-mode: nil -*-
+/*
+    Copyright (c) 2010 Juan Jose Garcia Ripoll
+
+    Tensor is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published
+    by the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Library General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include <tensor/linalg.h>
+#include <tensor/io.h>
+#include <mps/mpo.h>
+
+namespace mps {
+
+  /*
+   * The lowest eigenvalue of H is found with ARPACK's implicitly restarted
+   * Lanczos method, applying H onto the vectors with apply(MPO, Tensor),
+   * so that the matrix of H is never built. For very small spaces ARPACK
+   * fails and we use a full diagonalization instead.
+   */
+  template<class MPO, class Tensor>
+  static double
+  do_ground_state(const MPO &H, Tensor *v)
+  {
+    index n = 1;
+    for (index k = 0; k < H.size(); k++) {
+      n *= H[k].dimension(2);
+    }
+    Tensor E, psi;
+    if (n <= 10) {
+      E = linalg::eigs(mpo_to_matrix(H), linalg::SmallestAlgebraic, 1, &psi);
+    } else {
+      psi = (v && v->size() == n)? reshape(*v, n) : Tensor::random(n);
+      linalg::Arpack<Tensor> eigs(n, linalg::SmallestAlgebraic, 1);
+      eigs.set_maxiter(n);
+      eigs.set_start_vector(psi.begin());
+      while (eigs.update() < eigs.Finished) {
+        eigs.set_y(apply(H, Tensor(eigs.get_x())));
+      }
+      if (eigs.get_status() != eigs.Finished) {
+        std::cerr << "In ground_state(MPO, Tensor), the diagonalization "
+                  << "routine did not converge.\n"
+                  << eigs.error_message();
+        abort();
+      }
+      E = eigs.get_data(&psi);
+    }
+    if (v) {
+      *v = reshape(psi, n);
+    }
+    return real(E[0]);
+  }
+
+} // namespace mps
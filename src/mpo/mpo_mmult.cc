@@ -17,32 +17,91 @@
     51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
 */
 
-#include <mps/mpo.h>
+#include <mps/sparse_mpo.h>
 
 namespace mps {
 
-  template<class MPO>
-  static const MPO do_mmult(const MPO &A, const MPO &B)
+  template<class Tensor>
+  static const SparseMPO<Tensor>
+  do_mmult(const SparseMPO<Tensor> &A, const SparseMPO<Tensor> &B)
   {
-    typedef typename MPO::elt_t Tensor;
+    typedef typename SparseMPO<Tensor>::Site Site;
     assert(A.size() == B.size());
 
     index L = A.size();
-    MPO C = A;
-
-    for (index n = 0; n < L; n++) {
-      const Tensor &tA = A[n]; /* tA(a1,i,j,a2) */
-      const Tensor &tB = B[n]; /* tB(c1,j,k,c2) */
-      
-      /* tC(a1,i,c1,k,c2,a2) = tB(c1,j,k,c2) tA(a1,i,j,a2) */
-      Tensor tC = foldin(tB, 1, tA, 2);
-      index a1,i,a2,c1,k,c2;
-      tC.get_dimensions(&a1, &i, &c1, &k, &c2, &a2);
-      tC = reshape(permute(permute(tC, 1, 2), 4, 5), a1*c1, i, k, a2*c2);
-
-      C.at(n) = tC;
+    SparseMPO<Tensor> C(L);
+
+    for (index k = 0; k < L; k++) {
+      const Site &sA = A[k]; /* A(a1,i,j,a2) */
+      const Site &sB = B[k]; /* B(c1,j,k,c2) */
+      index a1 = sA.left_dimension(), a2 = sA.right_dimension();
+
+      /* C([a1,c1],i,k,[a2,c2]) = A(a1,i,j,a2) B(c1,j,k,c2), one pair of
+         blocks at a time. */
+      std::vector<Tensor> op;
+      std::vector<bool> identity;
+      typename SparseMPO<Tensor>::index_array_t left_ndx, right_ndx;
+      for (index nA = 0; nA < sA.size(); nA++) {
+        for (index nB = 0; nB < sB.size(); nB++) {
+          bool idA = sA.identity[nA], idB = sB.identity[nB];
+          Tensor O = idA? sB.op[nB] : (idB? sA.op[nA] : mmult(sA.op[nA], sB.op[nB]));
+          if (!idA && !idB && norm2(O) == 0)
+            continue;
+          op.push_back(O);
+          identity.push_back(idA && idB);
+          left_ndx.push_back(sA.left_ndx[nA] + a1 * sB.left_ndx[nB]);
+          right_ndx.push_back(sA.right_ndx[nA] + a2 * sB.right_ndx[nB]);
+        }
+      }
+      C.set_site(k, a1 * sB.left_dimension(), a2 * sB.right_dimension(),
+                 sA.d1, sB.d2, op, identity, left_ndx, right_ndx);
     }
     return C;
   }
 
+  template<class MPO>
+  static const MPO do_mmult(const MPO &A, const MPO &B)
+  {
+    typedef typename MPO::elt_t Tensor;
+    SparseMPO<Tensor> C = do_mmult(SparseMPO<Tensor>(A), SparseMPO<Tensor>(B));
+    MPO output = A;
+    for (index n = 0; n < output.size(); n++) {
+      output.at(n) = C.dense(n);
+    }
+    return output;
+  }
+
+  /* Exchange the channels c1 and c2 of the bond between sites k and k+1. */
+  template<class MPO>
+  static void swap_channels(MPO &mpo, index k, index c1, index c2)
+  {
+    typedef typename MPO::elt_t Tensor;
+    index b = mpo[k].dimension(3);
+    Indices perm(b);
+    for (index c = 0; c < b; c++) {
+      perm.at(c) = c;
+    }
+    perm.at(c1) = c2;
+    perm.at(c2) = c1;
+    mpo.at(k) = Tensor(mpo[k](range(), range(), range(), range(perm)));
+    mpo.at(k+1) = Tensor(mpo[k+1](range(perm), range(), range(), range()));
+  }
+
+  template<class MPO>
+  static const MPO do_mmult_compressed(const MPO &A, const MPO &B, double tol)
+  {
+    assert(A.size() == B.size());
+    MPO C = do_mmult(A, B);
+    /* In the product, the channel (a,c) is a+a2*c. (0,0) already is the
+       channel 0, but (1,1), where both operators are done, has to be
+       moved to 1 for compress() to preserve it. */
+    for (index k = 0; k+1 < C.size(); k++) {
+      index a2 = A[k].dimension(3), c2 = B[k].dimension(3);
+      if (a2 >= 2 && c2 >= 2) {
+        swap_channels(C, k, 1, 1 + a2);
+      }
+    }
+    return compress(C, tol);
+  }
+
 } // namespace mps
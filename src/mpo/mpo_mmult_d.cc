@@ -27,4 +27,14 @@ namespace mps {
     return do_mmult(A, B);
   }
 
+  const RMPO mmult_compressed(const RMPO &A, const RMPO &B, double tol)
+  {
+    return do_mmult_compressed(A, B, tol);
+  }
+
+  const RSparseMPO mmult(const RSparseMPO &A, const RSparseMPO &B)
+  {
+    return do_mmult(A, B);
+  }
+
 } // namespace mps
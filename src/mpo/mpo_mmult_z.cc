@@ -27,4 +27,14 @@ namespace mps {
     return do_mmult(A, B);
   }
 
+  const CMPO mmult_compressed(const CMPO &A, const CMPO &B, double tol)
+  {
+    return do_mmult_compressed(A, B, tol);
+  }
+
+  const CSparseMPO mmult(const CSparseMPO &A, const CSparseMPO &B)
+  {
+    return do_mmult(A, B);
+  }
+
 } // namespace mps
@@ -0,0 +1,176 @@
+// -*- mode: c++; fill-column: 80; c-basic-offset: 2; indent-tabs-mode: nil -*-
+/*
+    Copyright (c) 2010 Juan Jose Garcia Ripoll
+
+    Tensor is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published
+    by the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Library General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include <vector>
+#include <algorithm>
+#include <mps/mpo.h>
+#include <mps/sparse_mpo.h>
+
+namespace mps {
+
+  /* A nonzero matrix element O(i,j) of the operator that takes the
+     automaton of the MPO from channel 'a' to channel 'channel'. */
+  template<class number>
+  struct MPOMove {
+    index channel, state;
+    number value;
+  };
+
+  template<class number>
+  struct MPOMoves {
+    /* moves[i*c1+a] lists the matrix elements of the output state 'i'
+       that leave from channel 'a' */
+    std::vector<std::vector<MPOMove<number> > > moves;
+    index c1, d1, d2;
+  };
+
+  template<class number>
+  static bool
+  column_less(const std::pair<index,number> &a, const std::pair<index,number> &b)
+  {
+    return a.first < b.first;
+  }
+
+  template<class Tensor>
+  static const MPOMoves<typename Tensor::elt_t>
+  site_moves(const typename SparseMPO<Tensor>::Site &s)
+  {
+    typedef typename Tensor::elt_t number;
+    MPOMoves<number> output;
+    output.c1 = s.left_dimension();
+    output.d1 = s.d1;
+    output.d2 = s.d2;
+    output.moves.resize(output.c1 * s.d1);
+    for (index n = 0; n < s.size(); n++) {
+      MPOMove<number> m;
+      m.channel = s.right_ndx[n];
+      index a = s.left_ndx[n];
+      for (index i = 0; i < s.d1; i++) {
+        for (index j = 0; j < s.d2; j++) {
+          if (s.identity[n]) {
+            m.value = (i == j)? number(1.0) : number(0.0);
+          } else {
+            m.value = s.op[n](i,j);
+          }
+          if (m.value != number(0.0)) {
+            m.state = j;
+            output.moves.at(i * output.c1 + a).push_back(m);
+          }
+        }
+      }
+    }
+    return output;
+  }
+
+  /* Follows all paths of the automaton that produce the output state
+     'row' (one digit per site), from site k onwards, accumulating the
+     column and the value of the matrix element. */
+  template<class number>
+  static void
+  collect_row(const std::vector<MPOMoves<number> > &sites, const Indices &row,
+              const Indices &stride, index k, index a, index column,
+              number value, std::vector<std::pair<index,number> > *output)
+  {
+    if (k == sites.size()) {
+      output->push_back(std::make_pair(column, value));
+      return;
+    }
+    const MPOMoves<number> &s = sites[k];
+    const std::vector<MPOMove<number> > &moves = s.moves[row[k] * s.c1 + a];
+    for (index n = 0; n < moves.size(); n++) {
+      const MPOMove<number> &m = moves[n];
+      collect_row(sites, row, stride, k+1, m.channel,
+                  column + m.state * stride[k], value * m.value, output);
+    }
+  }
+
+  /*
+   * The matrix elements of the MPO are enumerated one row at a time, with
+   * a depth-first search over the channels of the automaton that skips
+   * the zero entries of the operators. Rows are processed in parallel in
+   * chunks and the nonzeros of each chunk are already sorted, so that the
+   * sparse matrix is built with a single pass over them. As in
+   * mpo_to_matrix(), site 0 is the fastest index.
+   */
+  template<class Sparse, class Tensor>
+  static const Sparse
+  do_mpo_to_sparse(const SparseMPO<Tensor> &mpo)
+  {
+    typedef typename Tensor::elt_t number;
+    typedef std::pair<index,number> entry_t;
+    index L = mpo.size();
+    std::vector<MPOMoves<number> > sites(L);
+    Indices dout(L), stride(L);
+    index rows = 1, cols = 1;
+    for (index k = 0; k < L; k++) {
+      sites.at(k) = site_moves<Tensor>(mpo[k]);
+      dout.at(k) = mpo[k].d1;
+      stride.at(k) = cols;
+      rows *= mpo[k].d1;
+      cols *= mpo[k].d2;
+    }
+
+    const index chunk = 1024;
+    index nchunks = (rows + chunk - 1) / chunk;
+    std::vector<std::vector<index> > chunk_rows(nchunks), chunk_cols(nchunks);
+    std::vector<std::vector<number> > chunk_values(nchunks);
+#pragma omp parallel for schedule(dynamic)
+    for (index c = 0; c < nchunks; c++) {
+      std::vector<entry_t> entries;
+      Indices row(L);
+      for (index r = c * chunk; r < std::min(rows, (c+1) * chunk); r++) {
+        for (index k = 0, x = r; k < L; k++) {
+          row.at(k) = x % dout[k];
+          x /= dout[k];
+        }
+        entries.clear();
+        collect_row(sites, row, stride, 0, 0, 0, number(1.0), &entries);
+        std::sort(entries.begin(), entries.end(), column_less<number>);
+        for (index n = 0; n < entries.size(); ) {
+          index column = entries[n].first;
+          number value = 0;
+          for (; n < entries.size() && entries[n].first == column; n++) {
+            value += entries[n].second;
+          }
+          if (value != number(0.0)) {
+            chunk_rows[c].push_back(r);
+            chunk_cols[c].push_back(column);
+            chunk_values[c].push_back(value);
+          }
+        }
+      }
+    }
+
+    index nonzero = 0;
+    for (index c = 0; c < nchunks; c++) {
+      nonzero += chunk_values[c].size();
+    }
+    Indices row_ndx(nonzero), col_ndx(nonzero);
+    Tensor values(nonzero);
+    for (index c = 0, n = 0; c < nchunks; c++) {
+      for (index m = 0; m < chunk_values[c].size(); m++, n++) {
+        row_ndx.at(n) = chunk_rows[c][m];
+        col_ndx.at(n) = chunk_cols[c][m];
+        values.at(n) = chunk_values[c][m];
+      }
+    }
+    return Sparse(row_ndx, col_ndx, values, rows, cols);
+  }
+
+} // namespace mps
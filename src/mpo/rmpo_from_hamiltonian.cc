@@ -19,6 +19,7 @@
 
 #include <cassert>
 #include <mps/mpo.h>
+#include "mpo_from_hamiltonian.cc"
 
 namespace mps {
 
@@ -34,18 +35,8 @@ namespace mps {
   RMPO::RMPO(const Hamiltonian &H, double t) :
     parent(H.size())
   {
-    clear(H.dimensions());
-    for (index i = 0; i < size(); i++) {
-      add_local_term(this, safe_real(H.local_term(i,t)), i);
-    }
-    for (index i = 0; i < size(); i++) {
-      for (index j = 0; j < H.interaction_depth(i, t); j++) {
-        RTensor Hi = safe_real(H.interaction_left(i, j, t));
-        RTensor Hj = safe_real(H.interaction_right(i, j, t));
-        if (!Hi.is_empty())
-          add_interaction(this, Hi, i, Hj);
-      }
-    }
+    fill_from_hamiltonian(*this, H, t, safe_real);
+    *this = compress(*this, 0);
   }
 
 } // namespace mps
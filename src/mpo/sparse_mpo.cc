@@ -0,0 +1,167 @@
+// -*- mode: c++; fill-column: 80; c-basic-offset: 2; indent-tabs-mode: nil -*-
+/*
+    Copyright (c) 2010 Juan Jose Garcia Ripoll
+
+    Tensor is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published
+    by the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Library General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include <mps/sparse_mpo.h>
+
+namespace mps {
+
+  template<class Tensor>
+  SparseMPO<Tensor>::SparseMPO(const MP<Tensor> &mpo) :
+    sites_(mpo.size())
+  {
+    for (index k = 0; k < mpo.size(); k++) {
+      const Tensor &tensor = mpo[k];
+      index a, d1, d2, b;
+      tensor.get_dimensions(&a, &d1, &d2, &b);
+      const Tensor Id = Tensor::eye(d1, d2);
+      std::vector<Tensor> op;
+      std::vector<bool> identity;
+      index_array_t left_ndx, right_ndx;
+      for (index i = 0; i < a; i++) {
+        for (index j = 0; j < b; j++) {
+          Tensor O = reshape(tensor(range(i), range(), range(), range(j)),
+                             d1, d2);
+          if (norm2(O) != 0) {
+            op.push_back(O);
+            identity.push_back(d1 == d2 && all_equal(O, Id));
+            left_ndx.push_back(i);
+            right_ndx.push_back(j);
+          }
+        }
+      }
+      set_site(k, a, b, d1, d2, op, identity, left_ndx, right_ndx);
+    }
+  }
+
+  template<class Tensor>
+  SparseMPO<Tensor>::SparseMPO(const std::vector<SparseMPO> &terms,
+                               const Tensor &weights) :
+    sites_(terms.size()? terms[0].size() : 0)
+  {
+    typedef typename Tensor::elt_t number;
+    index T = terms.size(), L = size();
+    assert(weights.size() == T);
+    // Offsets of the channels of each term in the bond on the left of
+    // the current site.
+    index_array_t offset(T, 0), next(T, 0);
+    for (index k = 0; k < L; k++) {
+      std::vector<Tensor> op;
+      std::vector<bool> identity;
+      index_array_t left_ndx, right_ndx;
+      index a = 0, b = 0;
+      for (index t = 0; t < T; t++) {
+        assert(terms[t].size() == L);
+        const Site &s = terms[t][k];
+        assert(s.d1 == terms[0][k].d1 && s.d2 == terms[0][k].d2);
+        if (k == 0) {
+          assert(s.left_dimension() == 1);
+          a = 1;
+        } else {
+          a += s.left_dimension();
+        }
+        if (k+1 == L) {
+          assert(s.right_dimension() == 1);
+          next.at(t) = 0;
+          b = 1;
+        } else {
+          next.at(t) = b;
+          b += s.right_dimension();
+        }
+        number w = (k == 0)? weights[t] : number(1.0);
+        for (index n = 0; n < s.size(); n++) {
+          if (w == number(1.0)) {
+            op.push_back(s.op[n]);
+            identity.push_back(s.identity[n]);
+          } else {
+            op.push_back(w * s.op[n]);
+            identity.push_back(false);
+          }
+          left_ndx.push_back(s.left_ndx[n] + offset[t]);
+          right_ndx.push_back(s.right_ndx[n] + next[t]);
+        }
+      }
+      set_site(k, a, b, terms[0][k].d1, terms[0][k].d2, op, identity,
+               left_ndx, right_ndx);
+      offset.swap(next);
+    }
+  }
+
+  template<class Tensor>
+  void
+  SparseMPO<Tensor>::set_site(index k, index a, index b, index d1, index d2,
+                              const std::vector<Tensor> &op,
+                              const std::vector<bool> &identity,
+                              const index_array_t &left_ndx,
+                              const index_array_t &right_ndx)
+  {
+    Site &s = sites_.at(k);
+    index n = op.size();
+    s.d1 = d1;
+    s.d2 = d2;
+    s.left_start.assign(a+1, 0);
+    s.right_start.assign(b+1, 0);
+    for (index m = 0; m < n; m++) {
+      ++s.left_start.at(left_ndx[m]+1);
+      ++s.right_start.at(right_ndx[m]+1);
+    }
+    for (index i = 0; i < a; i++) {
+      s.left_start.at(i+1) += s.left_start.at(i);
+    }
+    for (index j = 0; j < b; j++) {
+      s.right_start.at(j+1) += s.right_start.at(j);
+    }
+    // Counting sort of the operators by their left index, keeping the
+    // order of those that share it.
+    index_array_t next(s.left_start.begin(), s.left_start.end() - 1);
+    s.op.resize(n);
+    s.identity.resize(n);
+    s.left_ndx.resize(n);
+    s.right_ndx.resize(n);
+    for (index m = 0; m < n; m++) {
+      index p = next.at(left_ndx[m])++;
+      s.op.at(p) = op[m];
+      s.identity.at(p) = identity[m];
+      s.left_ndx.at(p) = left_ndx[m];
+      s.right_ndx.at(p) = right_ndx[m];
+    }
+    // ...and the list of them, sorted by their right index.
+    next.assign(s.right_start.begin(), s.right_start.end() - 1);
+    s.by_right.resize(n);
+    for (index m = 0; m < n; m++) {
+      s.by_right.at(next.at(s.right_ndx[m])++) = m;
+    }
+  }
+
+  template<class Tensor>
+  const Tensor
+  SparseMPO<Tensor>::dense(index k) const
+  {
+    const Site &s = sites_[k];
+    Tensor output = Tensor::zeros(s.left_dimension(), s.d1, s.d2,
+                                  s.right_dimension());
+    for (index n = 0; n < s.size(); n++) {
+      // Sums of MPOs may have several operators on the same block
+      output.at(range(s.left_ndx[n]), range(), range(), range(s.right_ndx[n])) =
+        output(range(s.left_ndx[n]), range(), range(), range(s.right_ndx[n])) +
+        reshape(s.op[n], 1, s.d1, s.d2, 1);
+    }
+    return output;
+  }
+
+} // namespace mps
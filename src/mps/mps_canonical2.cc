@@ -27,12 +27,14 @@
 namespace mps {
 
   template<class MPS, class Tensor>
-  static void set_canonical_2_sites_inner(MPS &P, const Tensor &Pij, index site,
-					  int sense, index Dmax, double tol, bool canonicalize_both)
+  static double set_canonical_2_sites_inner(MPS &P, const Tensor &Pij, index site,
+					    int sense, index Dmax, double tol, bool canonicalize_both)
   {
     /*
      * Since the projector that we obtained spans two sites, we have to split
-     * it, ensuring that we remain below the desired dimension Dmax.
+     * it, ensuring that we remain below the desired dimension Dmax. We return
+     * the weight of the singular values that were dropped, relative to the
+     * norm of Pij.
      */
     index a1, i1, j1, c1;
     Pij.get_dimensions(&a1, &i1, &j1, &c1);
@@ -49,6 +51,13 @@ namespace mps {
       abort();
     }
     index b1 = where_to_truncate(s, tol, Dmax);
+    double total = 0, discarded = 0;
+    for (index k = 0; k < s.size(); k++) {
+      double w = s[k] * s[k];
+      total += w;
+      if (k >= b1)
+        discarded += w;
+    }
     if (b1 != s.size()) {
 	Pi = change_dimension(Pi, -1, b1);
 	Pj = change_dimension(Pj, 0, b1);
@@ -71,6 +80,108 @@ namespace mps {
       else
         P.at(site-1) = Pi;
     }
+    return (total > 0)? (discarded / total) : 0.0;
+  }
+
+  template<class MPS, class Tensor>
+  static void set_canonical_2_sites_inner(MPS &P, const Tensor &Pij, index site,
+					  int sense, const RTensor &qrow,
+                                          const RTensor &qcol, RTensor *qbond,
+                                          index Dmax, double tol)
+  {
+    /*
+     * The two-site tensor conserves a U(1) charge: once reshaped into a
+     * matrix Pij([a1,i1],[j1,c1]), it is block diagonal, with rows and
+     * columns labelled by the charge that the new bond would carry. We
+     * decompose each block on its own and select the singular values that
+     * survive the truncation among all the blocks.
+     */
+    index a1, i1, j1, c1;
+    Pij.get_dimensions(&a1, &i1, &j1, &c1);
+    Tensor M = reshape(Pij, a1*i1, j1*c1);
+    assert(qrow.size() == a1*i1 && qcol.size() == j1*c1);
+
+    double qtol = FLAGS.get(MPS_CHARGE_TOLERANCE);
+    std::vector<double> charges;
+    for (index n = 0; n < qrow.size(); n++) {
+      double q = qrow[n];
+      bool found = false;
+      for (index m = 0; m < charges.size() && !found; m++)
+        found = (tensor::abs(charges[m] - q) < qtol);
+      if (!found)
+        charges.push_back(q);
+    }
+
+    std::vector<Tensor> U, V;
+    std::vector<RTensor> S;
+    std::vector<Indices> rows, cols;
+    std::vector<std::pair<double,index> > values;
+    for (index m = 0; m < charges.size(); m++) {
+      Indices r = which(abs(qrow - charges[m]) < qtol);
+      Indices c = which(abs(qcol - charges[m]) < qtol);
+      if (r.size() == 0 || c.size() == 0)
+        continue;
+      Tensor Ub, Vb;
+      RTensor s = linalg::svd(M(range(r), range(c)), &Ub, &Vb, SVD_ECONOMIC);
+      if (std::isnan(s(0))) {
+        std::cerr << "NaN found when doing canonical form" << std::endl;
+        std::cerr << "s=" << s << std::endl;
+        abort();
+      }
+      for (index k = 0; k < s.size(); k++)
+        values.push_back(std::make_pair(-s[k], U.size()));
+      U.push_back(Ub);
+      V.push_back(Vb);
+      S.push_back(s);
+      rows.push_back(r);
+      cols.push_back(c);
+    }
+    if (values.size() == 0) {
+      std::cerr << "In set_canonical_2_sites(), no pair of rows and columns "
+        "of the tensor has a compatible charge.\n";
+      abort();
+    }
+
+    // All singular values, sorted in decreasing order, determine
+    // how many of them are kept. Since within each block they are already
+    // sorted, we only need to count how many we retain from each.
+    std::stable_sort(values.begin(), values.end());
+    RTensor s(values.size());
+    for (index k = 0; k < values.size(); k++)
+      s.at(k) = -values[k].first;
+    index b1 = where_to_truncate(s, tol, Dmax);
+    std::vector<index> kept(U.size(), 0);
+    for (index k = 0; k < b1; k++)
+      kept[values[k].second]++;
+
+    Tensor Pi = Tensor::zeros(a1*i1, b1);
+    Tensor Pj = Tensor::zeros(b1, j1*c1);
+    *qbond = RTensor(b1);
+    s = RTensor(b1);
+    for (index m = 0, offset = 0; m < U.size(); m++) {
+      index k = kept[m];
+      if (k == 0)
+        continue;
+      Pi.at(range(rows[m]), range(offset, offset+k-1)) =
+        U[m](range(), range(0, k-1));
+      Pj.at(range(offset, offset+k-1), range(cols[m])) =
+        V[m](range(0, k-1), range());
+      s.at(range(offset, offset+k-1)) = S[m](range(0, k-1));
+      qbond->at(range(offset, offset+k-1)) =
+        qrow[rows[m][0]] * RTensor::ones(k);
+      offset += k;
+    }
+    Pi = reshape(Pi, a1,i1,b1);
+    Pj = reshape(Pj, b1,j1,c1);
+    if (sense > 0) {
+      P.at(site) = Pi;
+      scale_inplace(Pj, 0, s);
+      P.at(site+1) = Pj;
+    } else {
+      P.at(site) = Pj;
+      scale_inplace(Pi,-1, s);
+      P.at(site-1) = Pi;
+    }
   }
 
 } // namespace mps
@@ -21,12 +21,21 @@
 
 namespace mps {
 
-  void set_canonical_2_sites(RMPS &P, const RTensor &Pij, index site,
-			     int sense, index Dmax, double tol,
-                             bool canonicalize_both)
+  double set_canonical_2_sites(RMPS &P, const RTensor &Pij, index site,
+			       int sense, index Dmax, double tol,
+                               bool canonicalize_both)
   {
-    set_canonical_2_sites_inner(P, Pij, site, sense, Dmax, tol,
-                                canonicalize_both);
+    return set_canonical_2_sites_inner(P, Pij, site, sense, Dmax, tol,
+                                       canonicalize_both);
+  }
+
+  void set_canonical_2_sites(RMPS &P, const RTensor &Pij, index site, int sense,
+                             const RTensor &row_charges,
+                             const RTensor &column_charges,
+                             RTensor *bond_charges, index Dmax, double tol)
+  {
+    set_canonical_2_sites_inner(P, Pij, site, sense, row_charges,
+                                column_charges, bond_charges, Dmax, tol);
   }
 
 } // namespace mps
@@ -55,6 +55,12 @@ namespace mps {
 
   const unsigned MPS_SOLVE_TOLERANCE = FLAGS.create_key(1e-10);
 
+  const unsigned MPS_SOLVE_PRECONDITION = FLAGS.create_key(1);
+
+  const unsigned MPS_CHARGE_TOLERANCE = FLAGS.create_key(1e-10);
+
+  const unsigned MPS_ENVIRONMENT_WINDOW = FLAGS.create_key(0);
+
   const unsigned MPS_ITEBD_CANONICAL_EXPECTED = 1;
   const unsigned MPS_ITEBD_SLOW_EXPECTED = 2;
   const unsigned MPS_ITEBD_BDRY_EXPECTED = 3;
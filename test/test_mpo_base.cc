@@ -20,6 +20,8 @@
 #include "loops.h"
 #include <gtest/gtest.h>
 #include <mps/mpo.h>
+#include <mps/sparse_mpo.h>
+#include <mps/mps_algorithms.h>
 #include <mps/io.h>
 #include <mps/quantum.h>
 
@@ -245,6 +247,83 @@ namespace tensor_test {
     }
   }
 
+  /*
+   * MPO built directly from a Hamiltonian, which must have one channel per
+   * interaction term on each bond.
+   */
+  template<class MPO>
+  void test_hamiltonian_mpo(int size)
+  {
+    typedef typename MPO::elt_t Tensor;
+    typedef typename MPO::MPS MPS;
+
+    MPS psi = cluster_state(size);
+    ConstantHamiltonian H(size);
+    for (int j = 0; j < size; j++) {
+      H.set_local_term(j, rand<double>() * mps::Pauli_z +
+                       rand<double>() * mps::Pauli_x);
+    }
+    for (int j = 0; j < size-1; j++) {
+      H.set_interaction(j, rand<double>() * Pauli_z, Pauli_z);
+      H.add_interaction(j, rand<double>() * Pauli_x, Pauli_x);
+    }
+    MPO mpo(H);
+    for (int j = 0; j < size-1; j++) {
+      EXPECT_EQ(4, mpo[j].dimension(3));
+    }
+
+    Tensor mpo_times_psi = mps_to_vector(apply(mpo, psi));
+    Tensor H_times_psi = mmult(full(real(sparse_hamiltonian(H))),
+                               mps_to_vector(psi));
+
+    EXPECT_CEQ(norm2(mpo_times_psi - H_times_psi), 0.0);
+  }
+
+  /*
+   * Sparse representation of a Hamiltonian MPO: it reproduces the dense
+   * tensors, flags the identities and gives the same products.
+   */
+  template<class MPO>
+  void test_sparse_mpo(int size)
+  {
+    typedef typename MPO::elt_t Tensor;
+    typedef typename MPO::MPS MPS;
+    typedef SparseMPO<Tensor> Sparse;
+
+    MPO mpo(size, 2);
+    for (int j = 0; j < size; j++) {
+      Tensor Hloc = rand<double>() * mps::Pauli_z;
+      add_local_term(&mpo, Hloc, j);
+    }
+    for (int j = 0; j < size-1; j++) {
+      add_interaction(&mpo, rand<double>() * Pauli_x, j, Pauli_x);
+    }
+    Sparse sparse(mpo);
+    for (int j = 0; j < size; j++) {
+      EXPECT_TRUE(all_equal(sparse.dense(j), mpo[j]));
+      index identities = 0;
+      for (index n = 0; n < sparse[j].size(); n++) {
+        identities += sparse[j].identity[n];
+      }
+      EXPECT_EQ((j == 0 || j+1 == size)? 1 : 2, identities);
+    }
+
+    MPS psi = cluster_state(size);
+    Tensor dense_psi = mps_to_vector(psi);
+    Tensor H = mpo_to_matrix(mpo);
+    EXPECT_CEQ(norm2(mps_to_vector(apply(sparse, psi)) - mmult(H, dense_psi)), 0.0);
+    EXPECT_CEQ(expected(psi, sparse, psi), expected(psi, mpo, psi));
+
+    Sparse sparse2 = mmult(sparse, sparse);
+    MPO mpo2 = mmult(mpo, mpo);
+    for (int j = 0; j < size; j++) {
+      EXPECT_TRUE(all_equal(sparse2.dense(j), mpo2[j]));
+    }
+    EXPECT_CEQ(mpo_to_matrix(mpo2), mmult(H, H));
+    EXPECT_CEQ(norm2(mps_to_vector(apply(sparse2, psi)) -
+                     mmult(mmult(H, H), dense_psi)), 0.0);
+  }
+
   ////////////////////////////////////////////////////////////
 
   TEST(RMPO, Zero) {
@@ -263,6 +342,14 @@ namespace tensor_test {
     test_over_integers(2, 10, test_random_mpo<RMPO>);
   }
 
+  TEST(RMPO, FromHamiltonian) {
+    test_over_integers(2, 10, test_hamiltonian_mpo<RMPO>);
+  }
+
+  TEST(RMPO, Sparse) {
+    test_over_integers(2, 8, test_sparse_mpo<RMPO>);
+  }
+
   ////////////////////////////////////////////////////////////
 
   TEST(CMPO, Zero) {
@@ -281,5 +368,13 @@ namespace tensor_test {
     test_over_integers(2, 10, test_random_mpo<CMPO>);
   }
 
+  TEST(CMPO, FromHamiltonian) {
+    test_over_integers(2, 10, test_hamiltonian_mpo<CMPO>);
+  }
+
+  TEST(CMPO, Sparse) {
+    test_over_integers(2, 8, test_sparse_mpo<CMPO>);
+  }
+
 
 } // namespace test
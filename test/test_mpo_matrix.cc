@@ -19,6 +19,7 @@
 
 #include "loops.h"
 #include <gtest/gtest.h>
+#include <tensor/linalg.h>
 #include <mps/mpo.h>
 #include <mps/io.h>
 #include <mps/quantum.h>
@@ -66,6 +67,230 @@ namespace tensor_test {
   }
 
 
+  ////////////////////////////////////////////////////////////
+  // COMPRESSION OF MPOS
+  //
+
+  /* Sum of J(i,j) z_i z_j over all pairs, built with one product term per
+     pair, so that the bond dimension grows quadratically with the size. The
+     couplings are a sum of two exponentials, which gives inner channels of
+     rank 2. */
+  template<class MPO>
+  const MPO all_to_all_mpo(index L, const typename MPO::elt_t &z,
+                           double decay)
+  {
+    typedef typename MPO::elt_t Tensor;
+    Tensor i2 = Tensor::eye(2);
+    MPO mpo(L, 2);
+    for (index i = 0; i < L; i++) {
+      for (index j = i+1; j < L; j++) {
+        std::vector<Tensor> H(L, i2);
+        H.at(i) = z * (exp(-decay * (j - i)) + exp(-2 * decay * (j - i)));
+        H.at(j) = z;
+        add_product_term(&mpo, H);
+      }
+    }
+    return mpo;
+  }
+
+  template<class MPO>
+  void test_compress_mpo(const typename MPO::elt_t &z)
+  {
+    typedef typename MPO::elt_t Tensor;
+    index L = 6;
+    {
+      /* Uniform couplings: exact deparallelization leaves three channels */
+      MPO mpo = all_to_all_mpo<MPO>(L, z, 0.0);
+      MPO cmpo = compress(mpo, 0);
+      for (index k = 0; k+1 < L; k++) {
+        EXPECT_EQ(3, cmpo[k].dimension(3));
+      }
+      EXPECT_CEQ(mpo_to_matrix(mpo), mpo_to_matrix(cmpo));
+    }
+    {
+      /* Exponential couplings need the SVD to find the two inner channels */
+      MPO mpo = all_to_all_mpo<MPO>(L, z, 0.5);
+      EXPECT_EQ(5, compress(mpo, 0)[2].dimension(3));
+      MPO cmpo = compress(mpo, 1e-12);
+      for (index k = 0; k+1 < L; k++) {
+        EXPECT_LE(cmpo[k].dimension(3), 4);
+      }
+      Tensor M = mpo_to_matrix(mpo);
+      EXPECT_NEAR(0.0, norm2(M - mpo_to_matrix(cmpo)), 1e-8 * norm2(M));
+    }
+  }
+
+  /* A field parallel to the operator that opens the interactions, as in
+     the Ising model in a longitudinal field: compression must not merge
+     those channels into channel 1, which add_local_term() relies on. */
+  template<class MPO>
+  void test_compress_layout(const typename MPO::elt_t &z)
+  {
+    typedef typename MPO::elt_t Tensor;
+    for (index L = 2; L <= 6; L++) {
+      TestHamiltonian H(TestHamiltonian::ISING_Z_FIELD, 0.5, L, false, false);
+      MPO mpo = compress(MPO(H), 0);
+      Tensor M = mpo_to_matrix(mpo);
+      add_local_term(&mpo, z, 0);
+      EXPECT_CEQ(mpo_to_matrix(mpo), M + kron2(z, Tensor::eye(1 << (L-1))));
+    }
+  }
+
+  /* Sum of J(j-i) z_i z_j, fitted with exponentials, compared to the same
+     sum built with one product term per pair. */
+  template<class MPO>
+  void test_long_range_mpo(const typename MPO::elt_t &z)
+  {
+    typedef typename MPO::elt_t Tensor;
+    index L = 7;
+    Tensor i2 = Tensor::eye(2);
+    for (int exponential = 1; exponential >= 0; exponential--) {
+      RTensor J(L-1);
+      for (index r = 1; r < L; r++) {
+        J.at(r-1) = exponential? pow(0.5, (double)r) : 1.0 / (r * r);
+      }
+      MPO exact(L, 2);
+      for (index i = 0; i < L; i++) {
+        for (index j = i+1; j < L; j++) {
+          std::vector<Tensor> H(L, i2);
+          H.at(i) = J[j-i-1] * z;
+          H.at(j) = z;
+          add_product_term(&exact, H);
+        }
+      }
+      MPO mpo(L, 2);
+      double error = add_long_range_interaction(&mpo, z, z, J);
+      Tensor M = mpo_to_matrix(exact);
+      if (exponential) {
+        /* A single exponential is fitted exactly, with one channel */
+        for (index k = 0; k+1 < L; k++) {
+          EXPECT_EQ(3, mpo[k].dimension(3));
+        }
+        EXPECT_CEQ(M, mpo_to_matrix(mpo));
+      } else {
+        EXPECT_LE(error, 1e-3);
+        EXPECT_LE(norm2(M - mpo_to_matrix(mpo)),
+                  L * L * (error + 1e-14) * norm2(Tensor::eye(1 << L)));
+      }
+    }
+  }
+
+  /* Products and sums of Ising Hamiltonians, compressed as they are built */
+  template<class MPO>
+  void test_mpo_algebra(const typename MPO::elt_t &x,
+                        const typename MPO::elt_t &z)
+  {
+    typedef typename MPO::elt_t Tensor;
+    index L = 5;
+    MPO A(L, 2), B(L, 2);
+    for (index i = 0; i < L; i++) {
+      add_local_term(&A, z * (0.5 + i), i);
+      add_local_term(&B, x, i);
+      if (i+1 < L) {
+        add_interaction(&A, x, i, x);
+        add_interaction(&B, z * (1.0 + i), i, z);
+      }
+    }
+    Tensor MA = mpo_to_matrix(A), MB = mpo_to_matrix(B);
+
+    MPO AB = mmult_compressed(A, B);
+    EXPECT_CEQ(mpo_to_matrix(AB), mmult(MA, MB));
+    for (index k = 0; k+1 < L; k++) {
+      EXPECT_LE(AB[k].dimension(3), A[k].dimension(3) * B[k].dimension(3));
+    }
+    /* The product keeps channels 0 and 1 */
+    add_local_term(&AB, z, 2);
+    EXPECT_CEQ(mpo_to_matrix(AB),
+               mmult(MA, MB) + kron2(Tensor::eye(4), kron2(z, Tensor::eye(4))));
+
+    MPO AA = add(A, A);
+    EXPECT_CEQ(mpo_to_matrix(AA), 2.0 * MA);
+    for (index k = 0; k+1 < L; k++) {
+      EXPECT_EQ(A[k].dimension(3), AA[k].dimension(3));
+    }
+    /* The sum also keeps channels 0 and 1 */
+    add_local_term(&AA, z, 2);
+    EXPECT_CEQ(mpo_to_matrix(AA),
+               2.0 * MA + kron2(Tensor::eye(4), kron2(z, Tensor::eye(4))));
+    MPO AB2 = add(A, B);
+    EXPECT_CEQ(mpo_to_matrix(AB2), MA + MB);
+    add_local_term(&AB2, x, 0);
+    EXPECT_CEQ(mpo_to_matrix(AB2),
+               MA + MB + kron2(x, Tensor::eye(16)));
+  }
+
+  /* The matrix-free product of an MPO with a vector, and the ground state
+     computed on top of it, must agree with those of mpo_to_matrix(). */
+  template<class MPO>
+  void test_apply_vector(const typename MPO::elt_t &x,
+                         const typename MPO::elt_t &z)
+  {
+    typedef typename MPO::elt_t Tensor;
+    for (index L = 2; L <= 7; L++) {
+      MPO mpo = all_to_all_mpo<MPO>(L, z, 0.5);
+      for (index k = 0; k < L; k++) {
+        add_local_term(&mpo, x * (0.5 + 0.1 * k), k);
+      }
+      Tensor M = mpo_to_matrix(mpo);
+      Tensor v = Tensor::random(M.rows());
+      EXPECT_CEQ(apply(mpo, v), mmult(M, v));
+
+      RTensor e = linalg::eig_sym(M);
+      double Emin = e[0];
+      for (index i = 1; i < e.size(); i++) {
+        Emin = std::min(Emin, e[i]);
+      }
+      Tensor psi;
+      double E = ground_state(mpo, &psi);
+      EXPECT_NEAR(Emin, E, 1e-8);
+      EXPECT_NEAR(0.0, norm2(mmult(M, psi) - E * psi), 1e-6);
+    }
+  }
+
+  /* The sparse matrix of an MPO, including long-range terms, must be the
+     same as the dense one. */
+  template<class MPO>
+  void test_mpo_to_sparse(const typename MPO::elt_t &x,
+                          const typename MPO::elt_t &z)
+  {
+    for (index L = 2; L <= 7; L++) {
+      MPO mpo = all_to_all_mpo<MPO>(L, z, 0.5);
+      for (index k = 0; k < L; k++) {
+        add_local_term(&mpo, x * (0.5 + 0.1 * k), k);
+      }
+      EXPECT_CEQ(full(mpo_to_sparse(mpo)), mpo_to_matrix(mpo));
+    }
+  }
+
+  static const RTensor same_type(const RTensor &, const CTensor &M)
+  {
+    return real(M);
+  }
+
+  static const CTensor same_type(const CTensor &, const CTensor &M)
+  {
+    return M;
+  }
+
+  /* The MPO of a Hamiltonian, and its sparse matrix, must reproduce the
+     matrix that sparse_hamiltonian() builds from Kronecker products. */
+  template<class MPO>
+  void test_hamiltonian_sparse(index last_model)
+  {
+    typedef typename MPO::elt_t Tensor;
+    for (index model = 0; model <= last_model; model++) {
+      for (int ti = 0; ti < 2; ti++) {
+        for (index L = 2; L <= 6; L++) {
+          TestHamiltonian H(model, 0.5, L, ti, false);
+          MPO mpo(H);
+          Tensor M = mpo_to_matrix(mpo);
+          EXPECT_CEQ(M, same_type(M, full(sparse_hamiltonian(H))));
+          EXPECT_CEQ(full(mpo_to_sparse(mpo)), M);
+        }
+      }
+    }
+  }
+
   ////////////////////////////////////////////////////////////
   // EXPLICIT CONSTRUCTION OF MPOS AND RESULTING MATRICES
   //
@@ -127,6 +352,34 @@ namespace tensor_test {
     }
   }
 
+  TEST(RMPO, Compress) {
+    test_compress_mpo<RMPO>(real(mps::Pauli_z));
+  }
+
+  TEST(RMPO, CompressLayout) {
+    test_compress_layout<RMPO>(real(mps::Pauli_z));
+  }
+
+  TEST(RMPO, LongRangeInteraction) {
+    test_long_range_mpo<RMPO>(real(mps::Pauli_z));
+  }
+
+  TEST(RMPO, Algebra) {
+    test_mpo_algebra<RMPO>(real(mps::Pauli_x), real(mps::Pauli_z));
+  }
+
+  TEST(RMPO, ApplyVector) {
+    test_apply_vector<RMPO>(real(mps::Pauli_x), real(mps::Pauli_z));
+  }
+
+  TEST(RMPO, HamiltonianSparse) {
+    test_hamiltonian_sparse<RMPO>(TestHamiltonian::ISING_X_FIELD);
+  }
+
+  TEST(RMPO, ToSparse) {
+    test_mpo_to_sparse<RMPO>(real(mps::Pauli_x), real(mps::Pauli_z));
+  }
+
   //
   // CMPO
   //
@@ -184,5 +437,33 @@ namespace tensor_test {
     }
   }
 
+  TEST(CMPO, Compress) {
+    test_compress_mpo<CMPO>(mps::Pauli_z);
+  }
+
+  TEST(CMPO, CompressLayout) {
+    test_compress_layout<CMPO>(mps::Pauli_z);
+  }
+
+  TEST(CMPO, LongRangeInteraction) {
+    test_long_range_mpo<CMPO>(mps::Pauli_z);
+  }
+
+  TEST(CMPO, Algebra) {
+    test_mpo_algebra<CMPO>(mps::Pauli_x, mps::Pauli_z);
+  }
+
+  TEST(CMPO, ApplyVector) {
+    test_apply_vector<CMPO>(mps::Pauli_x, mps::Pauli_z);
+  }
+
+  TEST(CMPO, HamiltonianSparse) {
+    test_hamiltonian_sparse<CMPO>(TestHamiltonian::last_model());
+  }
+
+  TEST(CMPO, ToSparse) {
+    test_mpo_to_sparse<CMPO>(mps::Pauli_x, mps::Pauli_z);
+  }
+
 
 } // namespace test
@@ -17,12 +17,17 @@
     51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
 */
 
+#include <cstdio>
+#include <fstream>
 #include <tensor/io.h>
+#include <tensor/linalg.h>
 #include "loops.h"
 #include <gtest/gtest.h>
 #include <mps/mps.h>
 #include <mps/hamiltonian.h>
 #include <mps/minimizer.h>
+#include <mps/mps_algorithms.h>
+#include <mps/quantum.h>
 
 namespace tensor_test {
 
@@ -84,6 +89,210 @@ namespace tensor_test {
     EXPECT_CEQ3(angle, 1.0, 1e-10);
   }
 
+  // Minimize a Hamiltonian that conserves the total magnetization, within
+  // a sector of given magnetization, and compare the energy with that of
+  // an exact diagonalization in that sector.
+  template<class MPO>
+  void test_minimizer_U1(index L)
+  {
+    typedef typename MPO::MPS MPS;
+    typedef typename MPS::elt_t Tensor;
+    typedef typename Tensor::elt_t number;
+    TestHamiltonian H(TestHamiltonian::XXZ, 0.5, L, false, false);
+    MPO mpo(H);
+    Tensor sz = Tensor::zeros(2,2);
+    sz.at(0,0) = 1.0;
+    sz.at(1,1) = -1.0;
+    MPO Nmpo = local_Hamiltonian_mpo(std::vector<Tensor>(L, sz));
+    double value = L % 2;
+
+    MPS psi(L);
+    index D = 2;
+    for (index i = 0; i < L; i++) {
+      Tensor P = RTensor::random(D,2,D) - 0.5;
+      psi.at(i) = P / norm2(P);
+    }
+    psi.at(0) = psi[0](range(0),range(),range());
+    psi.at(L-1) = psi[L-1](range(),range(),range(0));
+
+    MinimizerOptions opts;
+    opts.Dmax = std::min(1<<(L/2),50);
+    double E = minimize(mpo, &psi, opts, Nmpo, value);
+
+    Tensor Hfull = mpo_to_matrix(mpo);
+    RTensor N = tensor::real(take_diag(mpo_to_matrix(Nmpo)));
+    Indices sector = which(abs(N - value) < 1e-10);
+    RTensor Es = linalg::eig_sym(Tensor(Hfull(range(sector), range(sector))));
+    double E0 = Es[0];
+    for (index i = 1; i < Es.size(); i++)
+      E0 = std::min(E0, Es[i]);
+    EXPECT_CEQ3(E, E0, 1e-8);
+
+    number Nexpected = expected(psi, Nmpo) / scprod(psi, psi);
+    EXPECT_CEQ3(Nexpected, number(value), 1e-8);
+  }
+
+  // Single-site minimization with subspace expansion, which has to grow
+  // the bonds of the initial state to find the exact ground state.
+  template<class MPO>
+  void test_minimizer_expansion(index L)
+  {
+    typedef typename MPO::MPS MPS;
+    typedef typename MPS::elt_t Tensor;
+    TestHamiltonian H(TestHamiltonian::HEISENBERG, 0.5, L, false, false);
+    MPO mpo(H);
+    MPS psi = MPS::random(L, 2, 1);
+
+    MinimizerOptions opts;
+    opts.Dmax = std::min(1<<(L/2),50);
+    opts.subspace_expansion = true;
+    double E = minimize(mpo, &psi, opts);
+
+    RTensor Es = linalg::eig_sym(Tensor(mpo_to_matrix(mpo)));
+    double E0 = Es[0];
+    for (index i = 1; i < Es.size(); i++)
+      E0 = std::min(E0, Es[i]);
+    EXPECT_CEQ3(E, E0, 1e-7);
+  }
+
+  // A minimization that runs out of sweeps leaves a checkpoint. With no
+  // sweeps left, a resumed call returns the saved state instead of the one
+  // it is given; with more sweeps it reaches the ground state.
+  template<class MPO>
+  void test_minimizer_checkpoint(index L)
+  {
+    typedef typename MPO::MPS MPS;
+    typedef typename MPS::elt_t Tensor;
+    TestHamiltonian H(TestHamiltonian::HEISENBERG, 0.5, L, false, false);
+    MPO mpo(H);
+
+    MinimizerOptions opts;
+    opts.Dmax = std::min(1<<(L/2),50);
+    opts.checkpoint_file = "test_minimizer_checkpoint.dat";
+    opts.checkpoint_every = 1;
+    opts.resume_from_checkpoint = true;
+    opts.sweeps = 1;
+    std::remove(opts.checkpoint_file.c_str());
+    MPS saved = MPS::random(L, 2, 2);
+    minimize(mpo, &saved, opts);
+    EXPECT_TRUE(std::ifstream(opts.checkpoint_file.c_str()).is_open());
+
+    MPS psi = MPS::random(L, 2, 2);
+    minimize(mpo, &psi, opts);
+    EXPECT_CEQ(mps_to_vector(psi), mps_to_vector(saved));
+
+    opts.sweeps = 32;
+    psi = MPS::random(L, 2, 2);
+    double E = minimize(mpo, &psi, opts);
+    EXPECT_FALSE(std::ifstream(opts.checkpoint_file.c_str()).is_open());
+
+    RTensor Es = linalg::eig_sym(Tensor(mpo_to_matrix(mpo)));
+    double E0 = Es[0];
+    for (index i = 1; i < Es.size(); i++)
+      E0 = std::min(E0, Es[i]);
+    EXPECT_CEQ3(E, E0, 1e-8);
+  }
+
+  // Ramping up the bond dimension and the tolerances, or letting the
+  // bond dimension grow with the discarded weight, must still lead to the
+  // exact ground state.
+  template<class MPO>
+  void test_minimizer_schedule(index L)
+  {
+    typedef typename MPO::MPS MPS;
+    typedef typename MPS::elt_t Tensor;
+    TestHamiltonian H(TestHamiltonian::HEISENBERG, 0.5, L, false, false);
+    MPO mpo(H);
+    RTensor Es = linalg::eig_sym(Tensor(mpo_to_matrix(mpo)));
+    double E0 = Es[0];
+    for (index i = 1; i < Es.size(); i++)
+      E0 = std::min(E0, Es[i]);
+    index Dfull = std::min(1<<(L/2),50);
+    {
+      MPS psi = MPS::random(L, 2, 1);
+      MinimizerOptions opts;
+      for (index D = 1; D < Dfull; D *= 2) {
+        opts.Dmax_schedule.push_back(D);
+        opts.svd_tolerance_schedule.push_back(1e-6 / D);
+        opts.eigs_tolerance_schedule.push_back(1e-4 / D);
+      }
+      opts.Dmax_schedule.push_back(Dfull);
+      opts.svd_tolerance_schedule.push_back(1e-11);
+      opts.eigs_tolerance_schedule.push_back(1e-10);
+      double E = minimize(mpo, &psi, opts);
+      EXPECT_CEQ3(E, E0, 1e-8);
+    }
+    {
+      MPS psi = MPS::random(L, 2, 1);
+      MinimizerOptions opts;
+      opts.Dmax = 1;
+      opts.target_discarded_weight = 1e-12;
+      opts.Dmax_limit = Dfull;
+      double E = minimize(mpo, &psi, opts);
+      EXPECT_CEQ3(E, E0, 1e-8);
+    }
+  }
+
+  // The eigenstate fidelity computed with the exact <psi|H^2|psi> is one
+  // for the ground state, and it agrees with the simplified estimate.
+  template<class MPO>
+  void test_minimizer_exact_fidelity(index L)
+  {
+    typedef typename MPO::MPS MPS;
+    TestHamiltonian H(TestHamiltonian::ISING_X_FIELD, 0.5, L, false, false);
+    MPO mpo(H);
+    MPS psi = MPS::random(L, 2, 1);
+
+    MinimizerOptions opts;
+    opts.Dmax = std::min(1<<(L/2),50);
+    opts.exact_eigenstate_fidelity = true;
+    double fidelity, err;
+    minimize(mpo, &psi, opts, fidelity, err);
+    EXPECT_CEQ3(fidelity, 1.0, 1e-8);
+    EXPECT_CEQ3(eigenstate_fidelity(mpo, psi), 1.0, 1e-8);
+
+    MPS phi = normal_form(MPS::random(L, 2, 2));
+    double simp_err;
+    EXPECT_CEQ3(eigenstate_fidelity(mpo, phi),
+                eigenstate_fidelity(mpo, phi, simp_err, 1e-13, 20, 0), 1e-8);
+  }
+
+  // Minimizing a weighted list of MPOs gives the same ground state as
+  // minimizing the MPO of their sum.
+  template<class MPO>
+  void test_minimizer_sum(index L)
+  {
+    typedef typename MPO::MPS MPS;
+    typedef typename MPS::elt_t Tensor;
+    std::vector<MPO> terms(2, MPO(L, 2));
+    MPO sum(L, 2);
+    for (index k = 0; k < L; k++) {
+      Tensor z = mps::Pauli_z;
+      add_local_term(&terms.at(1), z, k);
+      add_local_term(&sum, 1.3 * z, k);
+      if (k+1 < L) {
+        Tensor x = mps::Pauli_x;
+        add_interaction(&terms.at(0), x, k, x);
+        add_interaction(&sum, -0.7 * x, k, x);
+      }
+    }
+    Tensor weights(2);
+    weights.at(0) = -0.7;
+    weights.at(1) = 1.3;
+
+    MinimizerOptions opts;
+    opts.Dmax = std::min(1<<(L/2),50);
+    opts.exact_eigenstate_fidelity = true;
+    double fidelity, err;
+    MPS psi = MPS::random(L, 2, 1);
+    double E = minimize(weights, terms, &psi, opts, fidelity, err);
+    EXPECT_CEQ3(fidelity, 1.0, 1e-8);
+    EXPECT_CEQ3(E, real(expected(psi, sum)), 1e-8);
+
+    MPS phi = MPS::random(L, 2, 1);
+    EXPECT_CEQ3(E, minimize(sum, &phi, opts), 1e-8);
+  }
+
   ////////////////////////////////////////////////////////////
   // MINIMIZE RMPO
   //
@@ -116,6 +325,30 @@ namespace tensor_test {
     test_over_integers(2, 10, test_minimizer_model<RMPO,TestHamiltonian::HEISENBERG>);
   }
 
+  TEST(RMinimize, XXZFixedMagnetization) {
+    test_over_integers(2, 10, test_minimizer_U1<RMPO>);
+  }
+
+  TEST(RMinimize, HeisenbergSubspaceExpansion) {
+    test_over_integers(2, 10, test_minimizer_expansion<RMPO>);
+  }
+
+  TEST(RMinimize, Checkpoint) {
+    test_over_integers(2, 10, test_minimizer_checkpoint<RMPO>);
+  }
+
+  TEST(RMinimize, Schedules) {
+    test_over_integers(2, 10, test_minimizer_schedule<RMPO>);
+  }
+
+  TEST(RMinimize, ExactEigenstateFidelity) {
+    test_over_integers(2, 10, test_minimizer_exact_fidelity<RMPO>);
+  }
+
+  TEST(RMinimize, SumOfMPOs) {
+    test_over_integers(2, 10, test_minimizer_sum<RMPO>);
+  }
+
   ////////////////////////////////////////////////////////////
   // MINIMIZE CMPO
   //
@@ -148,5 +381,29 @@ namespace tensor_test {
     test_over_integers(2, 10, test_minimizer_model<CMPO,TestHamiltonian::HEISENBERG>);
   }
 
+  TEST(CMinimize, XXZFixedMagnetization) {
+    test_over_integers(2, 10, test_minimizer_U1<CMPO>);
+  }
+
+  TEST(CMinimize, HeisenbergSubspaceExpansion) {
+    test_over_integers(2, 10, test_minimizer_expansion<CMPO>);
+  }
+
+  TEST(CMinimize, Checkpoint) {
+    test_over_integers(2, 10, test_minimizer_checkpoint<CMPO>);
+  }
+
+  TEST(CMinimize, Schedules) {
+    test_over_integers(2, 10, test_minimizer_schedule<CMPO>);
+  }
+
+  TEST(CMinimize, ExactEigenstateFidelity) {
+    test_over_integers(2, 10, test_minimizer_exact_fidelity<CMPO>);
+  }
+
+  TEST(CMinimize, SumOfMPOs) {
+    test_over_integers(2, 10, test_minimizer_sum<CMPO>);
+  }
+
 } // tensor_test
 
@@ -21,6 +21,7 @@
 #include <gtest/gtest.h>
 #include <mps/mps.h>
 #include <mps/qform.h>
+#include <mps/flags.h>
 #include <mps/quantum.h>
 
 namespace tensor_test {
@@ -141,6 +142,135 @@ namespace tensor_test {
     }
   }
 
+  // Random MPO with bond dimension D, in which some of the (a,b) blocks of
+  // each tensor vanish, so that the nonzero transitions have no trivial order.
+  template<class MPO>
+  const MPO random_sparse_MPO(index size, int d, index D)
+  {
+    typedef typename MPO::elt_t Tensor;
+    MPO output(size, d);
+    for (index i = 0; i < size; i++) {
+      index a = (i == 0)? 1 : D;
+      index b = (i+1 == size)? 1 : D;
+      Tensor op = Tensor::random(a,d,d,b);
+      for (index n = 0; n < a; n++) {
+        for (index m = 0; m < b; m++) {
+          if ((n + 2*m + i) % 3 == 0)
+            op.at(range(n),range(),range(),range(m)) = Tensor::zeros(d,d);
+        }
+      }
+      output.at(i) = op;
+    }
+    return output;
+  }
+
+  // The matrix-free products with the quadratic form must agree with the
+  // explicit matrices, whatever the pattern of nonzero blocks of the MPO.
+  template<class MPO>
+  void test_qform_apply_sparse(int size)
+  {
+    typedef typename MPO::MPS MPS;
+    typedef typename MPS::elt_t Tensor;
+    for (int d = 2; d <= 3; d++) {
+      MPO mpo = random_sparse_MPO<MPO>(size, d, 4);
+      MPS psi = MPS::random(size, d, 3);
+      for (index i = 0; i < size; i++) {
+        QuadraticForm<MPO> qf(mpo, psi, psi, i);
+        Tensor P = psi[i];
+        Tensor H = qf.single_site_matrix();
+        EXPECT_CEQ3(mmult(H, flatten(P)),
+                    flatten(qf.apply_one_site_matrix(P)), 1e-10);
+        EXPECT_CEQ3(take_diag(H),
+                    flatten(qf.take_single_site_matrix_diag()), 1e-10);
+        if (i+1 < size) {
+          Tensor P12 = fold(psi[i], -1, psi[i+1], 0);
+          Tensor H12 = qf.two_site_matrix(+1);
+          EXPECT_CEQ3(mmult(H12, flatten(P12)),
+                      flatten(qf.apply_two_site_matrix(P12, +1)), 1e-10);
+          EXPECT_CEQ3(take_diag(H12),
+                      flatten(qf.take_two_site_matrix_diag(+1)), 1e-10);
+          QuadraticForm<MPO> qf2(mpo, psi, psi, i+1);
+          EXPECT_CEQ3(flatten(qf.apply_two_site_matrix(P12, +1)),
+                      flatten(qf2.apply_two_site_matrix(P12, -1)), 1e-10);
+        }
+      }
+    }
+  }
+
+  // The product computed block by block only skips blocks that are zero,
+  // so that it agrees with the dense one for any labelling of the bonds.
+  template<class MPO>
+  void test_qform_apply_blocks(int size)
+  {
+    typedef typename MPO::MPS MPS;
+    typedef typename MPS::elt_t Tensor;
+    MPO mpo = random_sparse_MPO<MPO>(size, 2, 4);
+    MPS psi = MPS::random(size, 2, 3);
+    for (index i = 0; i+1 < size; i++) {
+      QuadraticForm<MPO> qf(mpo, psi, psi, i);
+      Tensor P12 = fold(psi[i], -1, psi[i+1], 0);
+      index a1 = P12.dimension(0), a3 = P12.dimension(3);
+      RTensor qleft(a1), qright(a3);
+      for (index n = 0; n < a1; n++)
+        qleft.at(n) = n % 2;
+      for (index n = 0; n < a3; n++)
+        qright.at(n) = n % 3;
+      for (index n = 0; n < a1; n++) {
+        if (n % 2)
+          P12.at(range(n), range(), range(), range(0)) = Tensor::zeros(1,2,2,1);
+      }
+      EXPECT_CEQ3(qf.apply_two_site_matrix(P12, +1),
+                  qf.apply_two_site_matrix(P12, +1, qleft, qright), 1e-10);
+      QuadraticForm<MPO> qf2(mpo, psi, psi, i+1);
+      EXPECT_CEQ3(qf2.apply_two_site_matrix(P12, -1),
+                  qf2.apply_two_site_matrix(P12, -1, qleft, qright), 1e-10);
+    }
+  }
+
+  // Sets the size of the window of environments, restoring the previous
+  // value when it goes out of scope, even if an assertion fails.
+  struct EnvironmentWindow {
+    double old_window;
+    explicit EnvironmentWindow(double window) :
+      old_window(mps::FLAGS.get(MPS_ENVIRONMENT_WINDOW))
+    {
+      mps::FLAGS.set(MPS_ENVIRONMENT_WINDOW, window);
+    }
+    ~EnvironmentWindow() {
+      mps::FLAGS.set(MPS_ENVIRONMENT_WINDOW, old_window);
+    }
+  };
+
+  // Keeping only a few environments in memory, and the rest in a scratch
+  // file, must not change the quadratic form along a full sweep.
+  template<class MPO>
+  void test_qform_scratch(int size)
+  {
+    typedef typename MPO::MPS MPS;
+    typedef typename MPS::elt_t Tensor;
+    const index window = 2;
+    MPO mpo = random_sparse_MPO<MPO>(size, 2, 4);
+    MPS psi = MPS::random(size, 2, 3);
+    QuadraticForm<MPO> qf(mpo, psi, psi, 0);
+    EnvironmentWindow guard(window);
+    QuadraticForm<MPO> qf_scratch(mpo, psi, psi, 0);
+    for (int sense = +1; sense >= -1; sense -= 2) {
+      for (index n = 1; n < size; n++) {
+        index i = qf.here();
+        EXPECT_EQ(i, qf_scratch.here());
+        EXPECT_CEQ3(qf.apply_one_site_matrix(psi[i]),
+                    qf_scratch.apply_one_site_matrix(psi[i]), 1e-10);
+        // There are size+1 environments, and those outside the window
+        // must have been moved to the scratch file.
+        if ((index)size > 2*window+2) {
+          EXPECT_LT(qf_scratch.resident_environments(), (index)size+1);
+        }
+        qf.propagate(psi[i], psi[i], sense);
+        qf_scratch.propagate(psi[i], psi[i], sense);
+      }
+    }
+  }
+
   template<class MPS, void (*f)(MPS)>
   void try_over_states(int size) {
     f(cluster_state(size));
@@ -157,6 +287,18 @@ namespace tensor_test {
     test_over_integers(2, 10, try_over_states<RMPS,test_qform_canonical<RMPO> >);
   }
 
+  TEST(RQForm, ApplySparseMPO) {
+    test_over_integers(2, 6, test_qform_apply_sparse<RMPO>);
+  }
+
+  TEST(RQForm, ApplyChargeBlocks) {
+    test_over_integers(2, 6, test_qform_apply_blocks<RMPO>);
+  }
+
+  TEST(RQForm, ScratchEnvironments) {
+    test_over_integers(2, 10, test_qform_scratch<RMPO>);
+  }
+
   //--------------------------------------------------
 
   TEST(RQForm, ExpectedIsing) {
@@ -253,6 +395,18 @@ namespace tensor_test {
     test_over_integers(2, 10, try_over_states<CMPS,test_qform_canonical<CMPO> >);
   }
 
+  TEST(CQForm, ApplySparseMPO) {
+    test_over_integers(2, 6, test_qform_apply_sparse<CMPO>);
+  }
+
+  TEST(CQForm, ApplyChargeBlocks) {
+    test_over_integers(2, 6, test_qform_apply_blocks<CMPO>);
+  }
+
+  TEST(CQForm, ScratchEnvironments) {
+    test_over_integers(2, 10, test_qform_scratch<CMPO>);
+  }
+
   //--------------------------------------------------
 
   TEST(CQForm, ExpectedIsing) {
@@ -22,6 +22,11 @@
 #include <mps/hamiltonian.h>
 #include <mps/quantum.h>
 #include <mps/mps_algorithms.h>
+#include <mps/mpo.h>
+#include <mps/io.h>
+#include <tensor/linalg.h>
+#include <vector>
+#include <algorithm>
 
 namespace tensor_test {
 
@@ -127,6 +132,97 @@ namespace tensor_test {
     f(MPS::random(size, 2, 1));
   }
 
+  /*
+   * The fitted product H|psi> must be exact when the bond dimension is
+   * not limited.
+   */
+  template<class MPO>
+  void test_apply_and_compress(int size)
+  {
+    typedef typename MPO::elt_t Tensor;
+    typedef typename MPO::MPS MPS;
+
+    MPO mpo(size, 2);
+    for (int j = 0; j < size; j++) {
+      Tensor Hloc = rand<double>() * mps::Pauli_z;
+      add_local_term(&mpo, Hloc, j);
+    }
+    for (int j = 0; j < size-1; j++) {
+      add_interaction(&mpo, rand<double>() * Pauli_x, j, Pauli_x);
+    }
+    MPS psi = cluster_state(size);
+    double err;
+    MPS phi = apply_and_compress(mpo, psi, 0, 0.0, 2, &err);
+    EXPECT_CEQ(mps_to_vector(phi), mps_to_vector(apply(mpo, psi)));
+    EXPECT_LT(err, 1e-7);
+    EXPECT_LE(largest_bond_dimension(phi), 3 * largest_bond_dimension(psi));
+  }
+
+  /*
+   * solve_shifted() must reproduce the exact solution of (H - shift) P = Q
+   * when the bond dimension is not limited.
+   */
+  template<class MPO>
+  void test_solve_shifted(int size, typename MPO::elt_t::elt_t shift)
+  {
+    typedef typename MPO::elt_t Tensor;
+    typedef typename MPO::MPS MPS;
+
+    MPO mpo(size, 2);
+    for (int j = 0; j < size; j++) {
+      Tensor Hloc = rand<double>() * mps::Pauli_z;
+      add_local_term(&mpo, Hloc, j);
+    }
+    for (int j = 0; j < size-1; j++) {
+      add_interaction(&mpo, rand<double>() * Pauli_x, j, Pauli_x);
+    }
+    MPS Q = cluster_state(size);
+    MPS P;
+    double err = solve_shifted(mpo, shift, &P, Q, 12);
+    EXPECT_LE(err, 1e-6);
+    Tensor H = mpo_to_matrix(mpo);
+    Tensor x = mps_to_vector(P);
+    EXPECT_CEQ3(mmult(H, x) - shift * x, mps_to_vector(Q), 1e-6);
+  }
+
+  void test_solve_shifted_real(int size) {
+    test_solve_shifted<RMPO>(size, -1.0 - 2.0 * size);
+  }
+
+  /* A shift inside the spectrum makes H - shift indefinite. It is placed
+     halfway across the widest gap in the middle of the spectrum. */
+  void test_solve_shifted_interior(int size) {
+    RMPO mpo(size, 2);
+    for (int j = 0; j < size; j++) {
+      add_local_term(&mpo, (0.5 + 0.1 * j) * real(mps::Pauli_z), j);
+    }
+    for (int j = 0; j < size-1; j++) {
+      add_interaction(&mpo, 0.3 * real(mps::Pauli_x), j, real(mps::Pauli_x));
+    }
+    RTensor eigs = linalg::eig_sym(mpo_to_matrix(mpo));
+    std::vector<double> e(eigs.size());
+    for (index n = 0; n < eigs.size(); n++)
+      e.at(n) = eigs[n];
+    std::sort(e.begin(), e.end());
+    index k = e.size() / 4;
+    for (index n = k; n < (3 * e.size()) / 4; n++) {
+      if (e[n+1] - e[n] > e[k+1] - e[k])
+        k = n;
+    }
+    double shift = 0.5 * (e[k] + e[k+1]);
+    RMPS Q = cluster_state(size);
+    RMPS P;
+    double err = solve_shifted(mpo, shift, &P, Q, 20);
+    EXPECT_LE(err, 1e-6);
+    RTensor x = mps_to_vector(P);
+    EXPECT_CEQ3(mmult(mpo_to_matrix(mpo), x) - shift * x,
+                mps_to_vector(Q), 1e-6);
+  }
+
+  void test_solve_shifted_complex(int size) {
+    test_solve_shifted<CMPO>(size, cdouble(0.5, 1.0));
+  }
+
   ////////////////////////////////////////////////////////////
   // RQFORM
   //
@@ -155,5 +251,29 @@ namespace tensor_test {
     test_over_integers(2, 10, &try_over_states<CMPS,test_solve<xx_H>,true>);
   }
 
+  ////////////////////////////////////////////////////////////
+  // FITTED PRODUCTS AND SHIFTED SYSTEMS WITH MPOS
+  //
+
+  TEST(RMPO, ApplyAndCompress) {
+    test_over_integers(2, 8, test_apply_and_compress<RMPO>);
+  }
+
+  TEST(RMPO, SolveShifted) {
+    test_over_integers(2, 6, test_solve_shifted_real);
+  }
+
+  TEST(RMPO, SolveShiftedInterior) {
+    test_over_integers(2, 6, test_solve_shifted_interior);
+  }
+
+  TEST(CMPO, ApplyAndCompress) {
+    test_over_integers(2, 8, test_apply_and_compress<CMPO>);
+  }
+
+  TEST(CMPO, SolveShifted) {
+    test_over_integers(2, 6, test_solve_shifted_complex);
+  }
+
 } // tensor_test
 
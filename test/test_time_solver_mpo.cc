@@ -0,0 +1,140 @@
+// -*- mode: c++; fill-column: 80; c-basic-offset: 2; indent-tabs-mode: nil -*-
+/*
+    Copyright (c) 2010 Juan Jose Garcia Ripoll
+
+    Tensor is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published
+    by the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Library General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include <cmath>
+#include <vector>
+#include "loops.h"
+#include <gtest/gtest.h>
+#include <mps/mps.h>
+#include <mps/mpo.h>
+#include <mps/time_evolve.h>
+#include <mps/hamiltonian.h>
+#include <mps/quantum.h>
+#include <tensor/linalg.h>
+
+#include "test_time_solver.cc"
+
+#define MPO_SOLVER_EPSILON 1e-10
+
+namespace tensor_test {
+
+  template<int method>
+  const CMPS apply_H_MPO(const Hamiltonian &H, double dt, const CMPS &psi)
+  {
+    MPOSolver solver(H, dt, method);
+    CMPS aux = psi;
+    solver.one_step(&aux, 0);
+    return aux;
+  }
+
+  /* Both constructions are exact for local terms. */
+  template<int method>
+  void test_MPO_exact(const Hamiltonian &H, double dt, const CMPS &psi)
+  {
+    CMPS psi_t = psi;
+    MPOSolver solver(H, dt, method);
+    solver.one_step(&psi_t, 0);
+    EXPECT_CEQ3(norm2(psi_t), 1.0, MPO_SOLVER_EPSILON);
+
+    CTensor Hm = full(sparse_hamiltonian(H));
+    CTensor psi1 = mmult(expm(Hm * to_complex(0, -dt)), mps_to_vector(psi));
+    CTensor psi3 = mps_to_vector(psi_t);
+    EXPECT_LT(norm2(psi3 - psi1), MPO_SOLVER_EPSILON);
+  }
+
+  /* With interactions, the error of exp(tau H) is O(tau^2): halving tau
+     divides it by four. */
+  void test_exponential_order(const CMPO &H, int method)
+  {
+    CTensor Hm = mpo_to_matrix(H);
+    double err[2];
+    for (int n = 0; n < 2; n++) {
+      cdouble tau = to_complex(0.0, -0.02 / (n+1));
+      CTensor U = mpo_to_matrix(exponential_mpo(H, tau, method));
+      err[n] = norm2(U - expm(Hm * tau));
+    }
+    EXPECT_GT(err[0] / err[1], 3.0);
+  }
+
+  template<int method>
+  void test_long_range_order(int size)
+  {
+    CMPO H(size, 2);
+    for (index i = 0; i < size; i++) {
+      add_local_term(&H, to_complex(mps::Pauli_z * (0.3 * (i+1))), i);
+    }
+    RTensor J(size-1);
+    for (index r = 1; r < size; r++) {
+      J.at(r-1) = pow(0.5, (double)r);
+    }
+    add_long_range_interaction(&H, to_complex(mps::Pauli_x),
+                               to_complex(mps::Pauli_x), J);
+    test_exponential_order(H, method);
+  }
+
+  /* The field is parallel to the operator that opens the interaction, so
+     that the compressed MPO mixes local and interaction terms. */
+  template<int method>
+  void test_ising_z_field_order(int size)
+  {
+    TestHamiltonian H(TestHamiltonian::ISING_Z_FIELD, 0.5, size, false, false);
+    test_exponential_order(CMPO(H, 0.0), method);
+  }
+
+  ////////////////////////////////////////////////////////////
+  // EVOLVE WITH THE W^I AND W^II OPERATORS
+  //
+
+  TEST(MPOSolver, Identity) {
+    test_over_integers(2, 7, evolve_identity, apply_H_MPO<1>);
+    test_over_integers(2, 7, evolve_identity, apply_H_MPO<2>);
+  }
+
+  TEST(MPOSolver, GlobalPhase) {
+    test_over_integers(2, 7, evolve_global_phase, apply_H_MPO<1>);
+    test_over_integers(2, 7, evolve_global_phase, apply_H_MPO<2>);
+  }
+
+  TEST(MPOSolver, LocalOperatorSz) {
+    test_over_integers(2, 7, evolve_local_operator_sz, test_MPO_exact<1>);
+    test_over_integers(2, 7, evolve_local_operator_sz, test_MPO_exact<2>);
+  }
+
+  TEST(MPOSolver, LocalOperatorSx) {
+    test_over_integers(2, 7, evolve_local_operator_sx, test_MPO_exact<1>);
+    test_over_integers(2, 7, evolve_local_operator_sx, test_MPO_exact<2>);
+  }
+
+  TEST(MPOSolver, WIOrder) {
+    test_over_integers(3, 7, test_long_range_order<1>);
+  }
+
+  TEST(MPOSolver, WIIOrder) {
+    test_over_integers(3, 7, test_long_range_order<2>);
+  }
+
+  TEST(MPOSolver, WIOrderIsingZField) {
+    test_over_integers(2, 7, test_ising_z_field_order<1>);
+  }
+
+  TEST(MPOSolver, WIIOrderIsingZField) {
+    test_over_integers(2, 7, test_ising_z_field_order<2>);
+  }
+
+} // namespace tensor_test
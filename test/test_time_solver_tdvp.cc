@@ -0,0 +1,109 @@
+// -*- mode: c++; fill-column: 80; c-basic-offset: 2; indent-tabs-mode: nil -*-
+/*
+    Copyright (c) 2010 Juan Jose Garcia Ripoll
+
+    Tensor is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published
+    by the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Library General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include <vector>
+#include "loops.h"
+#include <gtest/gtest.h>
+#include <mps/mps.h>
+#include <mps/time_evolve.h>
+#include <mps/hamiltonian.h>
+#include <mps/quantum.h>
+#include <tensor/linalg.h>
+
+#include "test_time_solver.cc"
+
+#define TDVP_EPSILON 1e-9
+
+namespace tensor_test {
+
+  template<int Dmax, bool two_site>
+  const CMPS apply_H_TDVP(const Hamiltonian &H, double dt, const CMPS &psi)
+  {
+    TDVPSolver solver(H, dt, two_site);
+    CMPS aux = psi;
+    solver.one_step(&aux, Dmax);
+    return aux;
+  }
+
+  /* Hamiltonians with only local terms keep the state within the
+     manifold of MPS, where TDVP is exact. */
+  template<bool two_site>
+  void test_TDVP_exact(const Hamiltonian &H, double dt, const CMPS &psi)
+  {
+    CMPS psi_t = psi;
+    TDVPSolver solver(H, dt, two_site);
+    solver.one_step(&psi_t, 0);
+    EXPECT_CEQ3(norm2(psi_t), 1.0, TDVP_EPSILON);
+
+    CTensor Hm = full(sparse_hamiltonian(H));
+    CTensor psi1 = mmult(expm(Hm * to_complex(0, -dt)), mps_to_vector(psi));
+    CTensor psi3 = mps_to_vector(psi_t);
+    EXPECT_LT(norm2(psi3 - psi1), TDVP_EPSILON);
+  }
+
+  /* Interactions are integrated with a second order error. We take ten
+     steps and reuse the environments of the solver. */
+  void test_TDVP_interaction(const Hamiltonian &H, double dt, const CMPS &psi)
+  {
+    CMPS psi_t = psi;
+    TDVPSolver solver(H, dt / 10, true);
+    for (int i = 0; i < 10; i++) {
+      solver.one_step(&psi_t, 0);
+    }
+    EXPECT_CEQ3(norm2(psi_t), 1.0, TDVP_EPSILON);
+
+    CTensor Hm = full(sparse_hamiltonian(H));
+    CTensor psi1 = mmult(expm(Hm * to_complex(0, -dt)), mps_to_vector(psi));
+    CTensor psi3 = mps_to_vector(psi_t);
+    EXPECT_LT(norm2(psi3 - psi1), 1e-3);
+  }
+
+  ////////////////////////////////////////////////////////////
+  // EVOLVE WITH TDVP
+  //
+
+  TEST(TDVPSolver, Identity) {
+    test_over_integers(2, 7, evolve_identity, apply_H_TDVP<0,true>);
+    test_over_integers(2, 7, evolve_identity, apply_H_TDVP<0,false>);
+  }
+
+  TEST(TDVPSolver, GlobalPhase) {
+    test_over_integers(2, 7, evolve_global_phase, apply_H_TDVP<0,true>);
+    test_over_integers(2, 7, evolve_global_phase, apply_H_TDVP<0,false>);
+  }
+
+  TEST(TDVPSolver, LocalOperatorSz) {
+    test_over_integers(2, 7, evolve_local_operator_sz, test_TDVP_exact<true>);
+    test_over_integers(2, 7, evolve_local_operator_sz, test_TDVP_exact<false>);
+  }
+
+  TEST(TDVPSolver, LocalOperatorSx) {
+    test_over_integers(2, 7, evolve_local_operator_sx, test_TDVP_exact<true>);
+    test_over_integers(2, 7, evolve_local_operator_sx, test_TDVP_exact<false>);
+  }
+
+  TEST(TDVPSolver, NearestNeighborSzSz) {
+    test_over_integers(2, 7, evolve_interaction_zz, test_TDVP_interaction);
+  }
+
+  TEST(TDVPSolver, NearestNeighborSxSx) {
+    test_over_integers(2, 7, evolve_interaction_xx, test_TDVP_interaction);
+  }
+
+} // namespace tensor_test
@@ -0,0 +1,87 @@
+// -*- mode: c++; fill-column: 80; c-basic-offset: 2; indent-tabs-mode: nil -*-
+/*
+    Copyright (c) 2010 Juan Jose Garcia Ripoll
+
+    Tensor is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published
+    by the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Library General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include "loops.h"
+#include <gtest/gtest.h>
+#include <mps/mps.h>
+#include <mps/time_evolve.h>
+#include <mps/hamiltonian.h>
+#include <mps/quantum.h>
+#include <tensor/linalg.h>
+
+#include "test_time_solver.cc"
+
+#define TEBD_EPSILON 1e-10
+
+namespace tensor_test {
+
+  const CMPS apply_H_TEBD(const Hamiltonian &H, double dt, const CMPS &psi)
+  {
+    TEBDSolver solver(H, dt);
+    CMPS aux = psi;
+    solver.one_step(&aux, 0);
+    return aux;
+  }
+
+  /* All the test Hamiltonians are sums of commuting terms, for which the
+     Trotter decomposition is exact. Two steps of dt/2 also test that the
+     solver keeps the Vidal form between steps. */
+  void test_TEBD_exact(const Hamiltonian &H, double dt, const CMPS &psi)
+  {
+    CMPS psi_t = psi;
+    TEBDSolver solver(H, dt / 2);
+    double err = solver.one_step(&psi_t, 0);
+    err += solver.one_step(&psi_t, 0);
+    EXPECT_LT(err, TEBD_EPSILON);
+    EXPECT_CEQ3(norm2(psi_t), 1.0, TEBD_EPSILON);
+
+    CTensor Hm = full(sparse_hamiltonian(H));
+    CTensor psi1 = mmult(expm(Hm * to_complex(0, -dt)), mps_to_vector(psi));
+    EXPECT_LT(norm2(mps_to_vector(psi_t) - psi1), TEBD_EPSILON);
+  }
+
+  ////////////////////////////////////////////////////////////
+  // EVOLVE WITH TEBD ON THE VIDAL FORM
+  //
+
+  TEST(TEBDSolver, Identity) {
+    test_over_integers(2, 10, evolve_identity, apply_H_TEBD);
+  }
+
+  TEST(TEBDSolver, GlobalPhase) {
+    test_over_integers(2, 10, evolve_global_phase, apply_H_TEBD);
+  }
+
+  TEST(TEBDSolver, LocalOperatorSz) {
+    test_over_integers(2, 7, evolve_local_operator_sz, test_TEBD_exact);
+  }
+
+  TEST(TEBDSolver, LocalOperatorSx) {
+    test_over_integers(2, 7, evolve_local_operator_sx, test_TEBD_exact);
+  }
+
+  TEST(TEBDSolver, NearestNeighborSzSz) {
+    test_over_integers(2, 7, evolve_interaction_zz, test_TEBD_exact);
+  }
+
+  TEST(TEBDSolver, NearestNeighborSxSx) {
+    test_over_integers(2, 7, evolve_interaction_xx, test_TEBD_exact);
+  }
+
+} // namespace tensor_test
@@ -120,4 +120,23 @@ namespace tensor_test {
     test_over_integers(2, 5, evolve_interaction_xx, test_Trotter2_truncated<4>);
   }
 
+  /* Two random states joined by a bond of dimension one. The pair of sites
+     around that bond has outer bonds larger than the physical dimension
+     times the inner one, which is handled with the reduced update. */
+  TEST(Trotter2Solver, ReducedUpdate) {
+    CMPS A = CMPS::random(3, 2, 4), B = CMPS::random(3, 2, 4);
+    CMPS psi(6, 2, 1);
+    for (index k = 0; k < 3; k++) {
+      psi.at(k) = A[k];
+      psi.at(k+3) = B[k];
+    }
+    psi.at(0) = psi[0] / norm2(psi);
+    ConstantHamiltonian H(6);
+    for (index i = 0; i < 6; i++) {
+      H.set_local_term(i, mps::Pauli_z * 0.3);
+      if (i > 0) H.add_interaction(i-1, mps::Pauli_x, mps::Pauli_x);
+    }
+    test_Trotter2_no_truncation(H, 0.1, psi);
+  }
+
 } // namespace tensor_test
@@ -64,6 +64,62 @@ namespace tensor_test {
     EXPECT_CEQ(mps_to_vector(aux), aux2);
   }
 
+  /* Three steps with merged layers equal three separate steps. */
+  void test_Trotter3_evolve(const Hamiltonian &H, double dt, const CMPS &psi)
+  {
+    CMPS aux = psi;
+    Trotter3Solver solver(H, dt);
+    solver.strategy = Trotter2Solver::DO_NOT_TRUNCATE;
+    double err = solver.evolve(&aux, 3, 0);
+    EXPECT_CEQ(err, 0.0);
+    EXPECT_CEQ(norm2(aux), 1.0);
+    CTensor aux2 = mps_to_vector(psi);
+    for (int n = 0; n < 3; n++) {
+      aux2 = apply_trotter3(H, to_complex(0.0,-dt), aux2);
+    }
+    EXPECT_CEQ(mps_to_vector(aux), aux2);
+  }
+
+  /* One step of evolve() equals one_step() for every strategy, and with
+     merged layers three steps equal three separate steps. */
+  void test_ForestRuth_evolve(const Hamiltonian &H, double dt, const CMPS &psi)
+  {
+    for (int strategy = 0; strategy <= TrotterSolver::DO_NOT_TRUNCATE;
+         strategy++) {
+      index Dmax = (strategy == TrotterSolver::DO_NOT_TRUNCATE)? 0 : 4;
+      ForestRuthSolver solver1(H, dt), solver2(H, dt);
+      switch (strategy) {
+      case TrotterSolver::TRUNCATE_GROUPS:
+        solver1.strategy = solver2.strategy = TrotterSolver::TRUNCATE_GROUPS;
+        break;
+      case TrotterSolver::TRUNCATE_EACH_LAYER:
+        solver1.strategy = solver2.strategy = TrotterSolver::TRUNCATE_EACH_LAYER;
+        break;
+      case TrotterSolver::TRUNCATE_EACH_UNITARY:
+        solver1.strategy = solver2.strategy = TrotterSolver::TRUNCATE_EACH_UNITARY;
+        break;
+      default:
+        solver1.strategy = solver2.strategy = TrotterSolver::DO_NOT_TRUNCATE;
+      }
+      solver1.normalize = solver2.normalize = true;
+      CMPS aux1 = psi, aux2 = psi;
+      double err1 = solver1.one_step(&aux1, Dmax);
+      double err2 = solver2.evolve(&aux2, 1, Dmax);
+      EXPECT_CEQ(err1, err2);
+      EXPECT_CEQ(mps_to_vector(aux1), mps_to_vector(aux2));
+    }
+    ForestRuthSolver solver1(H, dt), solver2(H, dt);
+    solver1.strategy = solver2.strategy = TrotterSolver::DO_NOT_TRUNCATE;
+    solver1.normalize = solver2.normalize = true;
+    CMPS aux1 = psi, aux2 = psi;
+    for (int n = 0; n < 3; n++) {
+      solver1.one_step(&aux1, 0);
+    }
+    solver2.evolve(&aux2, 3, 0);
+    EXPECT_CEQ(norm2(aux2), 1.0);
+    EXPECT_CEQ(mps_to_vector(aux1), mps_to_vector(aux2));
+  }
+
   template<int Dmax>
   void test_Trotter3_truncated(const Hamiltonian &H, double dt, const CMPS &psi)
   {
@@ -120,4 +176,20 @@ namespace tensor_test {
     test_over_integers(2, 5, evolve_interaction_xx, test_Trotter3_truncated<4>);
   }
 
+  TEST(Trotter3Solver, EvolveSxSx) {
+    test_over_integers(2, 5, evolve_interaction_xx, test_Trotter3_evolve);
+  }
+
+  TEST(Trotter3Solver, EvolveSzSz) {
+    test_over_integers(2, 5, evolve_interaction_zz, test_Trotter3_evolve);
+  }
+
+  TEST(ForestRuthSolver, EvolveSxSx) {
+    test_over_integers(2, 5, evolve_interaction_xx, test_ForestRuth_evolve);
+  }
+
+  TEST(ForestRuthSolver, EvolveSzSz) {
+    test_over_integers(2, 5, evolve_interaction_zz, test_ForestRuth_evolve);
+  }
+
 } // namespace tensor_test